@@ -0,0 +1,246 @@
+#include "batch.h"
+#include "branch_predictor.h"
+#include "functional.h"
+#include "loader.h"
+#include "output.h"
+#include "pipeline.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct BatchJob {
+    fs::path input;
+    fs::path output;
+    uintmax_t file_size = 0;
+};
+
+struct BatchResult {
+    bool ok = false;
+    std::string error;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint8_t stat = Y86::STAT_AOK;
+    double seconds = 0.0;
+    std::vector<LoadDiagnostic> diagnostics;
+};
+
+// 展开目录并为每个程序分配输出文件名（同名文件追加序号）
+std::vector<BatchJob> collectJobs(const BatchOptions& options) {
+    std::vector<fs::path> files;
+    for (const auto& input : options.inputs) {
+        fs::path path(input);
+        if (fs::is_directory(path)) {
+            std::vector<fs::path> found;
+            for (const auto& entry : fs::directory_iterator(path)) {
+                const auto ext = entry.path().extension();
+                if (entry.is_regular_file() && (ext == ".yo" || ext == ".ybo")) {
+                    found.push_back(entry.path());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else if (fs::is_regular_file(path)) {
+            files.push_back(path);
+        } else {
+            throw std::runtime_error("Cannot open input " + input);
+        }
+    }
+
+    std::vector<BatchJob> jobs;
+    std::map<std::string, int> used_names;
+    for (const auto& file : files) {
+        std::string name = file.stem().string();
+        int seen = used_names[name]++;
+        if (seen > 0) {
+            name += "_" + std::to_string(seen + 1);
+        }
+        BatchJob job;
+        job.input = file;
+        job.output = fs::path(options.output_dir) / (name + ".json");
+        std::error_code ec;
+        job.file_size = fs::file_size(file, ec);
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+// 运行一个模拟器并把状态写到 out，两种引擎共用
+template <typename Simulator>
+void simulate(Simulator& simulator, const ProgramImage& program,
+              const BatchOptions& options, FILE* out, BatchResult& result) {
+    simulator.setMemoryConfig(options.mem_config);
+    simulator.loadProgram(program);
+
+    JsonTraceWriter writer(out);
+    simulator.setRecordTrace(false);
+    simulator.setStateSink([&writer](const typename Simulator::State& state) {
+        writer.write(state);
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    simulator.run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    writer.finish();
+
+    result.seconds = elapsed.count();
+    result.instructions = simulator.getPerformanceStats().instructions_retired;
+    if (!simulator.getTrace().empty()) {
+        result.stat = simulator.getTrace().back().STAT;
+    }
+}
+
+void runJob(const BatchJob& job, const BatchOptions& options, BatchResult& result) {
+    try {
+        ProgramImage program = loadProgramFile(job.input.string(), &result.diagnostics);
+        if (program.empty()) {
+            throw std::runtime_error("No program loaded");
+        }
+
+        std::unique_ptr<FILE, int (*)(FILE*)> out(
+            std::fopen(job.output.string().c_str(), "wb"), &std::fclose);
+        if (!out) {
+            throw std::runtime_error("Cannot open output " + job.output.string());
+        }
+        if (options.engine == "functional") {
+            FunctionalSimulator simulator;
+            simulate(simulator, program, options, out.get(), result);
+        } else {
+            PipelineSimulator simulator;
+            simulator.setBranchPredictor(makeBranchPredictor(options.predictor));
+            simulator.setReturnAddressStackDepth(options.ras_depth);
+            simulator.setLoadUseBypass(options.load_bypass);
+            if (options.icache) simulator.setICache(options.icache_config);
+            if (options.dcache) simulator.setDCache(options.dcache_config);
+            simulate(simulator, program, options, out.get(), result);
+            result.cycles = simulator.getPerformanceStats().total_cycles;
+        }
+        result.ok = true;
+    } catch (const std::exception& e) {
+        result.ok = false;
+        result.error = e.what();
+    }
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char tmp[8];
+            std::snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+            out += tmp;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void writeSummary(const BatchOptions& options, const std::vector<BatchJob>& jobs,
+                  const std::vector<BatchResult>& results, size_t threads,
+                  double wall_seconds, size_t failed) {
+    fs::path path = fs::path(options.output_dir) / "summary.json";
+    FILE* out = std::fopen(path.string().c_str(), "wb");
+    if (!out) {
+        throw std::runtime_error("Cannot open output " + path.string());
+    }
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "    \"engine\": \"%s\",\n", jsonEscape(options.engine).c_str());
+    std::fprintf(out, "    \"jobs\": %zu,\n", threads);
+    std::fprintf(out, "    \"programs\": %zu,\n", jobs.size());
+    std::fprintf(out, "    \"failed\": %zu,\n", failed);
+    std::fprintf(out, "    \"wall_time_ms\": %.3f,\n", wall_seconds * 1000.0);
+    std::fprintf(out, "    \"results\": [");
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const BatchResult& r = results[i];
+        std::fprintf(out, "%s\n        {\"input\": \"%s\", \"output\": \"%s\", ",
+                     i == 0 ? "" : ",", jsonEscape(jobs[i].input.string()).c_str(),
+                     jsonEscape(jobs[i].output.string()).c_str());
+        if (r.ok) {
+            std::fprintf(out, "\"ok\": true, \"STAT\": %u, \"instructions\": %llu, "
+                         "\"cycles\": %llu, \"time_ms\": %.3f}",
+                         static_cast<unsigned>(r.stat),
+                         static_cast<unsigned long long>(r.instructions),
+                         static_cast<unsigned long long>(r.cycles), r.seconds * 1000.0);
+        } else {
+            std::fprintf(out, "\"ok\": false, \"error\": \"%s\"}", jsonEscape(r.error).c_str());
+        }
+    }
+    std::fprintf(out, "%s]\n}\n", jobs.empty() ? "" : "\n    ");
+    std::fclose(out);
+}
+
+}  // namespace
+
+int runBatch(const BatchOptions& options) {
+    std::vector<BatchJob> jobs;
+    try {
+        jobs = collectJobs(options);
+        fs::create_directories(options.output_dir);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // 工作线程从自己队列的尾部取任务，所以按文件从小到大提交，
+    // 让大文件先开始，减少最后只剩一个长任务在跑的情况
+    std::vector<size_t> order(jobs.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b) {
+        return jobs[a].file_size < jobs[b].file_size;
+    });
+
+    std::vector<BatchResult> results(jobs.size());
+    auto start = std::chrono::steady_clock::now();
+    size_t threads;
+    {
+        ThreadPool pool(options.jobs);
+        threads = pool.size();
+        for (size_t index : order) {
+            pool.submit([&jobs, &results, &options, index] {
+                runJob(jobs[index], options, results[index]);
+            });
+        }
+        pool.wait();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    size_t failed = 0;
+    uint64_t instructions = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        for (const auto& diag : results[i].diagnostics) {
+            std::cerr << "Warning: " << jobs[i].input.string() << ":" << diag.line << ": "
+                      << diag.message << std::endl;
+        }
+        if (!results[i].ok) {
+            failed++;
+            std::cerr << "Error: " << jobs[i].input.string() << ": " << results[i].error << std::endl;
+        }
+        instructions += results[i].instructions;
+    }
+
+    try {
+        writeSummary(options, jobs, results, threads, elapsed.count(), failed);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cerr << "Batch: " << jobs.size() << " programs, " << failed << " failed, "
+              << threads << " threads, " << elapsed.count() * 1000.0 << " ms, "
+              << instructions << " instructions" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
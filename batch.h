@@ -0,0 +1,30 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "y86.h"
+#include "cache.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 批量模式配置
+struct BatchOptions {
+    std::vector<std::string> inputs;         // 程序文件或目录（目录下所有 .yo/.ybo 文件）
+    std::string output_dir = "batch_out";    // 每个程序输出 <名字>.json，另加 summary.json
+    size_t jobs = 0;                          // 工作线程数，0 表示硬件线程数
+    std::string engine = "pipeline";
+    MemoryConfig mem_config;
+    std::string predictor = "nt";
+    size_t ras_depth = 0;
+    bool load_bypass = false;
+    bool icache = false;
+    bool dcache = false;
+    Cache::Config icache_config;
+    Cache::Config dcache_config;
+};
+
+// 在一个进程内用线程池模拟所有程序，每个程序使用独立的模拟器实例。
+// 返回进程退出码：全部成功为0，有程序失败（无法读取/没有程序）为1
+int runBatch(const BatchOptions& options);
+
+#endif // BATCH_H
@@ -0,0 +1,434 @@
+// 模拟器热点路径的微基准（make bench 构建并运行）
+//
+// 用法: ./cpu_bench [--repeat=N] [--scale=F] [--filter=子串]
+//   --repeat  每项重复次数（先预热一次，报告中位数），默认 5
+//   --scale   合成程序规模的比例 (0, 1]，默认 1（最大规模不超过模拟器的周期上限）
+//   --filter  只运行名字包含该子串的项目
+
+#include "y86.h"
+#include "pipeline.h"
+#include "functional.h"
+#include "decode_cache.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// 直接测量 PipelineSimulator 的私有转发逻辑（pipeline.h 中声明为友元）
+class PipelineBench {
+public:
+    // 每次迭代对 inputs 中的每个 D/E 寄存器应用转发，返回操作数之和
+    static uint64_t forwarding(const std::vector<D_E_Register>& inputs,
+                               const E_M_Register& e_m, const M_W_Register& m_w, uint64_t rounds) {
+        uint64_t sum = 0;
+        for (uint64_t r = 0; r < rounds; r++) {
+            for (const auto& d_e : inputs) {
+                ExecuteOperands ops = PipelineSimulator::applyForwarding(d_e, e_m, m_w, nullptr);
+                sum += ops.valA + ops.valB;
+            }
+        }
+        return sum;
+    }
+};
+
+namespace {
+
+// 被测循环的结果写到这里，防止被编译器优化掉
+volatile uint64_t sink;
+
+// 生成合成程序的最小汇编器（标号在 finish() 时回填）
+class Assembler {
+public:
+    void label(const std::string& name) { labels_[name] = code_.size(); }
+
+    void halt() { code_.push_back(0x00); }
+    void ret() { code_.push_back(0x90); }
+    void irmovq(uint64_t imm, uint8_t rB) {
+        code_.push_back(0x30);
+        code_.push_back(static_cast<uint8_t>(0xF0 | rB));
+        imm64(imm);
+    }
+    void irmovq(const std::string& target, uint8_t rB) {
+        code_.push_back(0x30);
+        code_.push_back(static_cast<uint8_t>(0xF0 | rB));
+        fixup(target);
+    }
+    void opq(uint8_t ifun, uint8_t rA, uint8_t rB) {
+        code_.push_back(static_cast<uint8_t>(0x60 | ifun));
+        code_.push_back(static_cast<uint8_t>((rA << 4) | rB));
+    }
+    void rmmovq(uint8_t rA, uint64_t disp, uint8_t rB) {
+        code_.push_back(0x40);
+        code_.push_back(static_cast<uint8_t>((rA << 4) | rB));
+        imm64(disp);
+    }
+    void mrmovq(uint64_t disp, uint8_t rB, uint8_t rA) {
+        code_.push_back(0x50);
+        code_.push_back(static_cast<uint8_t>((rA << 4) | rB));
+        imm64(disp);
+    }
+    void jxx(uint8_t cond, const std::string& target) {
+        code_.push_back(static_cast<uint8_t>(0x70 | cond));
+        fixup(target);
+    }
+    void call(const std::string& target) {
+        code_.push_back(0x80);
+        fixup(target);
+    }
+    void pushq(uint8_t rA) {
+        code_.push_back(0xA0);
+        code_.push_back(static_cast<uint8_t>((rA << 4) | 0xF));
+    }
+    void popq(uint8_t rA) {
+        code_.push_back(0xB0);
+        code_.push_back(static_cast<uint8_t>((rA << 4) | 0xF));
+    }
+
+    std::vector<uint8_t> finish() {
+        for (const auto& fix : fixups_) {
+            uint64_t addr = labels_.at(fix.second);
+            for (int i = 0; i < 8; i++) {
+                code_[fix.first + i] = static_cast<uint8_t>(addr >> (i * 8));
+            }
+        }
+        return code_;
+    }
+
+private:
+    void imm64(uint64_t val) {
+        for (int i = 0; i < 8; i++) {
+            code_.push_back(static_cast<uint8_t>(val >> (i * 8)));
+        }
+    }
+    void fixup(const std::string& target) {
+        fixups_.push_back({code_.size(), target});
+        imm64(0);
+    }
+
+    std::vector<uint8_t> code_;
+    std::map<std::string, uint64_t> labels_;
+    std::vector<std::pair<size_t, std::string>> fixups_;
+};
+
+// 紧凑循环：每次迭代 3 条指令，JNE 每次都跳转
+std::vector<uint8_t> loopProgram(uint64_t iterations) {
+    Assembler a;
+    a.irmovq(iterations, Y86::RCX);
+    a.irmovq(1, Y86::RDX);
+    a.irmovq(0, Y86::RAX);
+    a.label("loop");
+    a.opq(Y86::ADD, Y86::RCX, Y86::RAX);
+    a.opq(Y86::SUB, Y86::RDX, Y86::RCX);
+    a.jxx(Y86::C_NE, "loop");
+    a.halt();
+    return a.finish();
+}
+
+// 深递归：rounds 次调用深度为 depth 的递归求和（每层压栈 16 字节）
+std::vector<uint8_t> recursionProgram(uint64_t depth, uint64_t rounds) {
+    Assembler a;
+    a.irmovq(Memory::DEFAULT_SIZE, Y86::RSP);
+    a.irmovq(rounds, Y86::R8);
+    a.irmovq(1, Y86::R9);
+    a.label("outer");
+    a.irmovq(depth, Y86::RDI);
+    a.call("rec");
+    a.opq(Y86::SUB, Y86::R9, Y86::R8);
+    a.jxx(Y86::C_NE, "outer");
+    a.halt();
+    a.label("rec");
+    a.opq(Y86::AND, Y86::RDI, Y86::RDI);
+    a.jxx(Y86::C_E, "base");
+    a.pushq(Y86::RDI);
+    a.opq(Y86::SUB, Y86::R9, Y86::RDI);
+    a.call("rec");
+    a.popq(Y86::RDI);
+    a.opq(Y86::ADD, Y86::RDI, Y86::RAX);
+    a.ret();
+    a.label("base");
+    a.ret();
+    return a.finish();
+}
+
+// 内存扫描：passes 遍先顺序写 words 个字，再顺序读回求和
+constexpr uint64_t SWEEP_BASE = 0x10000;
+std::vector<uint8_t> sweepProgram(uint64_t words, uint64_t passes) {
+    Assembler a;
+    a.irmovq(passes, Y86::R8);
+    a.irmovq(1, Y86::R9);
+    a.irmovq(8, Y86::R10);
+    a.label("pass");
+    a.irmovq(SWEEP_BASE, Y86::RSI);
+    a.irmovq(words, Y86::RCX);
+    a.label("write");
+    a.rmmovq(Y86::RCX, 0, Y86::RSI);
+    a.opq(Y86::ADD, Y86::R10, Y86::RSI);
+    a.opq(Y86::SUB, Y86::R9, Y86::RCX);
+    a.jxx(Y86::C_NE, "write");
+    a.irmovq(SWEEP_BASE, Y86::RSI);
+    a.irmovq(words, Y86::RCX);
+    a.label("read");
+    a.mrmovq(0, Y86::RSI, Y86::RBX);
+    a.opq(Y86::ADD, Y86::RBX, Y86::RAX);
+    a.opq(Y86::ADD, Y86::R10, Y86::RSI);
+    a.opq(Y86::SUB, Y86::R9, Y86::RCX);
+    a.jxx(Y86::C_NE, "read");
+    a.opq(Y86::SUB, Y86::R9, Y86::R8);
+    a.jxx(Y86::C_NE, "pass");
+    a.halt();
+    return a.finish();
+}
+
+struct Options {
+    int repeat = 5;
+    double scale = 1.0;
+    std::string filter;
+};
+
+// 一次运行的工作量：items 为指令数或操作数，cycles 只对流水线有意义
+struct Work {
+    uint64_t items = 0;
+    uint64_t cycles = 0;
+};
+
+// 中位数计时：预热一次后重复 repeat 次
+void measure(const Options& options, const std::string& name, const char* unit,
+             const std::function<Work()>& body) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+
+    Work work = body();
+    std::vector<double> times;
+    for (int i = 0; i < options.repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        work = body();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        times.push_back(elapsed.count());
+    }
+    std::sort(times.begin(), times.end());
+    double median = times[times.size() / 2];
+
+    std::printf("%-28s %12llu %-6s %10.3f ms %10.2f M%s/s", name.c_str(),
+                static_cast<unsigned long long>(work.items), unit, median * 1e3,
+                work.items / median / 1e6, unit);
+    if (work.cycles) {
+        std::printf(" %10.2f Mcycles/s", work.cycles / median / 1e6);
+    }
+    std::printf("\n");
+}
+
+uint64_t scaled(uint64_t full, double scale) {
+    uint64_t n = static_cast<uint64_t>(full * scale);
+    return n > 0 ? n : 1;
+}
+
+// 完整的 run() 循环（不保留历史状态，与 --quiet 相同）
+void benchPrograms(const Options& options) {
+    struct Program {
+        const char* name;
+        std::vector<uint8_t> code;
+    };
+    // 规模按流水线约 100 万周期的上限选取
+    const Program programs[] = {
+        {"loop", loopProgram(scaled(150000, options.scale))},
+        {"recursion", recursionProgram(scaled(5000, options.scale), 10)},
+        {"sweep", sweepProgram(scaled(16384, options.scale), 3)},
+    };
+
+    for (const auto& program : programs) {
+        measure(options, std::string("pipeline.run/") + program.name, "inst", [&]() {
+            PipelineSimulator sim;
+            sim.setRecordTrace(false);
+            sim.loadProgram(program.code);
+            sim.run();
+            auto stats = sim.getPerformanceStats();
+            return Work{stats.instructions_retired, stats.total_cycles};
+        });
+        measure(options, std::string("functional.run/") + program.name, "inst", [&]() {
+            FunctionalSimulator sim;
+            sim.setRecordTrace(false);
+            sim.loadProgram(program.code);
+            sim.run();
+            return Work{sim.getPerformanceStats().instructions_retired, 0};
+        });
+    }
+}
+
+void benchMemory(const Options& options) {
+    const uint64_t words = scaled(64 * 1024, options.scale);
+    const uint64_t rounds = 16;
+
+    Memory mem;
+    measure(options, "memory.write64", "op", [&]() {
+        for (uint64_t r = 0; r < rounds; r++) {
+            // 与模拟器一致：每次退休（这里每次写入）之后清除脏字列表
+            for (uint64_t i = 0; i < words; i++) {
+                mem.write64(SWEEP_BASE + i * 8, i + r);
+                mem.clearDirty();
+            }
+        }
+        return Work{rounds * words, 0};
+    });
+    // 加载程序映像：大段零（.quad 0 数组）中夹着少量非零数据
+    std::vector<uint8_t> image(scaled(512 * 1024, options.scale));
+    for (size_t i = 0; i < image.size(); i += 8) {
+        if ((i / 8) % 64 < 4) image[i] = static_cast<uint8_t>(i / 8 + 1);
+    }
+    measure(options, "memory.writeBytes/load", "B", [&]() {
+        Memory fresh;
+        fresh.writeBytes(0, image.data(), image.size());
+        return Work{image.size(), 0};
+    });
+    measure(options, "memory.read64", "op", [&]() {
+        uint64_t sum = 0;
+        for (uint64_t r = 0; r < rounds; r++) {
+            for (uint64_t i = 0; i < words; i++) {
+                sum += mem.read64(SWEEP_BASE + i * 8);
+            }
+        }
+        sink = sum;
+        return Work{rounds * words, 0};
+    });
+    measure(options, "memory.read64/unaligned", "op", [&]() {
+        uint64_t sum = 0;
+        for (uint64_t r = 0; r < rounds; r++) {
+            for (uint64_t i = 0; i < words; i++) {
+                sum += mem.read64(SWEEP_BASE + i * 8 + 3);
+            }
+        }
+        sink = sum;
+        return Work{rounds * words, 0};
+    });
+}
+
+void benchDecode(const Options& options) {
+    // 译码 sweep 程序中的全部指令（覆盖大部分指令格式）
+    std::vector<uint8_t> code = sweepProgram(16, 1);
+    Memory mem;
+    mem.writeBytes(0, code.data(), code.size());
+    std::vector<uint64_t> pcs;
+    for (uint64_t pc = 0; pc < code.size();) {
+        pcs.push_back(pc);
+        pc += Y86::decodeInstruction(mem, pc).length;
+    }
+    const uint64_t rounds = scaled(200000, options.scale);
+
+    measure(options, "decodeInstruction", "inst", [&]() {
+        uint64_t sum = 0;
+        for (uint64_t r = 0; r < rounds; r++) {
+            for (uint64_t pc : pcs) {
+                sum += Y86::decodeInstruction(mem, pc).valC;
+            }
+        }
+        sink = sum;
+        return Work{rounds * pcs.size(), 0};
+    });
+    measure(options, "DecodeCache.lookup", "inst", [&]() {
+        DecodeCache cache;
+        uint64_t sum = 0;
+        for (uint64_t r = 0; r < rounds; r++) {
+            for (uint64_t pc : pcs) {
+                sum += cache.lookup(mem, pc).valC;
+            }
+        }
+        sink = sum;
+        return Work{rounds * pcs.size(), 0};
+    });
+}
+
+// recordState 的主体：每条退休记录改一个寄存器，每 4 条写一个内存字
+void benchTrace(const Options& options) {
+    const uint64_t records = scaled(1000000, options.scale);
+    for (bool retain : {false, true}) {
+        measure(options, retain ? "TraceLog.append/retain" : "TraceLog.append/stream", "rec", [&]() {
+            TraceLog trace;
+            trace.setRetain(retain);
+            RegisterFile regs;
+            Memory mem;
+            ConditionCodes cc;
+            for (uint64_t i = 0; i < records; i++) {
+                regs.set(static_cast<uint8_t>(i % 15), static_cast<int64_t>(i));
+                if (i % 4 == 0) {
+                    mem.write64(SWEEP_BASE + (i % 4096) * 8, i);
+                }
+                trace.append(i, regs, mem, cc, Y86::STAT_AOK);
+                mem.clearDirty();
+            }
+            return Work{records, 0};
+        });
+    }
+}
+
+void benchForwarding(const Options& options) {
+    // 覆盖各条转发路径：E/M.valE、M/W.valE、M/W.valM、寄存器文件
+    E_M_Register e_m;
+    e_m.valid = true;
+    e_m.icode = Y86::OPQ;
+    e_m.dstE = Y86::RAX;
+    e_m.valE = 1;
+    M_W_Register m_w;
+    m_w.valid = true;
+    m_w.icode = Y86::MRMOVQ;
+    m_w.dstE = Y86::RSP;
+    m_w.dstM = Y86::RBX;
+    m_w.valE = 2;
+    m_w.valM = 3;
+
+    std::vector<D_E_Register> inputs;
+    const uint8_t sources[] = {Y86::RAX, Y86::RSP, Y86::RBX, Y86::RCX, Y86::RNONE};
+    for (uint8_t a : sources) {
+        for (uint8_t b : sources) {
+            D_E_Register d_e;
+            d_e.valid = true;
+            d_e.icode = Y86::OPQ;
+            d_e.srcA = a;
+            d_e.srcB = b;
+            inputs.push_back(d_e);
+        }
+    }
+    const uint64_t rounds = scaled(400000, options.scale);
+
+    measure(options, "applyForwarding", "op", [&]() {
+        uint64_t sum = PipelineBench::forwarding(inputs, e_m, m_w, rounds);
+        sink = sum;
+        return Work{rounds * inputs.size(), 0};
+    });
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--repeat=", 0) == 0) {
+            options.repeat = std::atoi(arg.c_str() + 9);
+        } else if (arg.rfind("--scale=", 0) == 0) {
+            options.scale = std::atof(arg.c_str() + 8);
+        } else if (arg.rfind("--filter=", 0) == 0) {
+            options.filter = arg.substr(9);
+        } else {
+            return false;
+        }
+    }
+    return options.repeat > 0 && options.scale > 0 && options.scale <= 1;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: %s [--repeat=N] [--scale=F (0,1]] [--filter=SUBSTR]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%-28s %19s %13s %18s\n", "# benchmark", "work", "median", "throughput");
+    benchPrograms(options);
+    benchMemory(options);
+    benchDecode(options);
+    benchTrace(options);
+    benchForwarding(options);
+    return 0;
+}
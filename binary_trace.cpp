@@ -0,0 +1,147 @@
+#include "binary_trace.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+void storeLE(uint8_t* p, uint64_t val, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = static_cast<uint8_t>(val >> (i * 8));
+    }
+}
+
+uint64_t loadLE(const uint8_t* p, int bytes) {
+    uint64_t val = 0;
+    for (int i = 0; i < bytes; i++) {
+        val |= static_cast<uint64_t>(p[i]) << (i * 8);
+    }
+    return val;
+}
+
+}  // namespace
+
+// BinaryTraceWriter 实现
+BinaryTraceWriter::BinaryTraceWriter(FILE* out) : out_(out) {
+    buf_.reserve(BUFFER_SIZE + 4096);
+    uint8_t header[BinaryTrace::HEADER_SIZE] = {};
+    std::memcpy(header, BinaryTrace::MAGIC, sizeof(BinaryTrace::MAGIC));
+    storeLE(header + 4, BinaryTrace::VERSION, 4);
+    storeLE(header + 8, BinaryTrace::RECORD_SIZE, 4);
+    put(header, sizeof(header));
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+    flush();
+}
+
+void BinaryTraceWriter::put(const uint8_t* data, size_t len) {
+    buf_.insert(buf_.end(), data, data + len);
+    if (buf_.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+void BinaryTraceWriter::putU64(uint64_t val) {
+    uint8_t tmp[8];
+    storeLE(tmp, val, 8);
+    put(tmp, sizeof(tmp));
+}
+
+void BinaryTraceWriter::flush() {
+    if (!buf_.empty()) {
+        std::fwrite(buf_.data(), 1, buf_.size(), out_);
+        buf_.clear();
+    }
+    std::fflush(out_);
+}
+
+void BinaryTraceWriter::writeRecord(const ArchState& state, uint8_t flags, uint32_t mem_count) {
+    uint8_t rec[BinaryTrace::RECORD_SIZE];
+    storeLE(rec, state.PC, 8);
+    for (int i = 0; i < 15; i++) {
+        storeLE(rec + 8 + i * 8, static_cast<uint64_t>(state.regs.get(i)), 8);
+    }
+    rec[128] = static_cast<uint8_t>((state.CC.ZF ? 1 : 0) | (state.CC.SF ? 2 : 0) | (state.CC.OF ? 4 : 0));
+    rec[129] = state.STAT;
+    rec[130] = flags;
+    rec[131] = 0;
+    storeLE(rec + 132, mem_count, 4);
+    put(rec, sizeof(rec));
+}
+
+void BinaryTraceWriter::write(const TraceLog& trace) {
+    if (trace.lastWasFull()) {
+        write(trace.back());
+        return;
+    }
+    const auto& deltas = trace.lastMemDeltas();
+    writeRecord(trace.back(), 0, static_cast<uint32_t>(deltas.size()));
+    for (const auto& delta : deltas) {
+        putU64(delta.addr);
+        putU64(static_cast<uint64_t>(delta.val));
+    }
+}
+
+void BinaryTraceWriter::write(const ArchState& state) {
+    writeRecord(state, BinaryTrace::FLAG_FULL, static_cast<uint32_t>(state.mem_snapshot.size()));
+    for (const auto& pair : state.mem_snapshot) {
+        putU64(pair.first);
+        putU64(static_cast<uint64_t>(pair.second));
+    }
+}
+
+// BinaryTraceReader 实现
+BinaryTraceReader::BinaryTraceReader(FILE* in) : in_(in) {
+    uint8_t header[BinaryTrace::HEADER_SIZE];
+    if (!read(header, sizeof(header)) ||
+        std::memcmp(header, BinaryTrace::MAGIC, sizeof(BinaryTrace::MAGIC)) != 0) {
+        throw std::runtime_error("Not a binary trace");
+    }
+    if (loadLE(header + 4, 4) != BinaryTrace::VERSION ||
+        loadLE(header + 8, 4) != BinaryTrace::RECORD_SIZE) {
+        throw std::runtime_error("Unsupported binary trace version");
+    }
+}
+
+bool BinaryTraceReader::read(uint8_t* data, size_t len) {
+    return std::fread(data, 1, len, in_) == len;
+}
+
+bool BinaryTraceReader::next() {
+    uint8_t rec[BinaryTrace::RECORD_SIZE];
+    size_t got = std::fread(rec, 1, sizeof(rec), in_);
+    if (got == 0) return false;
+    if (got != sizeof(rec)) {
+        throw std::runtime_error("Truncated binary trace record");
+    }
+
+    state_.PC = loadLE(rec, 8);
+    for (int i = 0; i < 15; i++) {
+        state_.regs.set(i, static_cast<int64_t>(loadLE(rec + 8 + i * 8, 8)));
+    }
+    state_.CC.ZF = (rec[128] & 1) != 0;
+    state_.CC.SF = (rec[128] & 2) != 0;
+    state_.CC.OF = (rec[128] & 4) != 0;
+    state_.STAT = rec[129];
+    uint8_t flags = rec[130];
+    size_t mem_count = static_cast<size_t>(loadLE(rec + 132, 4));
+
+    if (flags & BinaryTrace::FLAG_FULL) {
+        state_.mem_snapshot.clear();
+    }
+    mem_buf_.resize(mem_count * BinaryTrace::MEM_ENTRY_SIZE);
+    if (!read(mem_buf_.data(), mem_buf_.size())) {
+        throw std::runtime_error("Truncated binary trace memory entries");
+    }
+    for (size_t i = 0; i < mem_count; i++) {
+        const uint8_t* p = mem_buf_.data() + i * BinaryTrace::MEM_ENTRY_SIZE;
+        uint64_t addr = loadLE(p, 8);
+        int64_t val = static_cast<int64_t>(loadLE(p + 8, 8));
+        if (val != 0) {
+            state_.mem_snapshot[addr] = val;
+        } else {
+            state_.mem_snapshot.erase(addr);
+        }
+    }
+    return true;
+}
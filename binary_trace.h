@@ -0,0 +1,69 @@
+#ifndef BINARY_TRACE_H
+#define BINARY_TRACE_H
+
+#include "trace.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// 二进制退休状态格式（所有整数均为小端序）
+//
+//   文件头（16字节）：魔数 "Y86T"、版本号(4)、记录定长部分大小(4)、保留(4)
+//   每条记录：
+//     定长部分（136字节）：PC(8)、15个寄存器(8*15)、CC(1, bit0=ZF bit1=SF bit2=OF)、
+//                          STAT(1)、标志(1, bit0=完整内存快照)、保留(1)、内存项数N(4)
+//     变长部分：N 个内存项，每项 地址(8)、值(8)
+//   普通记录的内存项是相对上一条记录的变化（值为0表示该字变回零）；
+//   带完整快照标志的记录列出全部非零字。
+namespace BinaryTrace {
+    constexpr char MAGIC[4] = {'Y', '8', '6', 'T'};
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 16;
+    constexpr size_t RECORD_SIZE = 136;
+    constexpr size_t MEM_ENTRY_SIZE = 16;
+    constexpr uint8_t FLAG_FULL = 0x01;
+}
+
+// 带缓冲的二进制状态输出（用法同 JsonTraceWriter，内存变化取自 TraceLog）
+class BinaryTraceWriter {
+public:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    explicit BinaryTraceWriter(FILE* out);
+    ~BinaryTraceWriter();
+
+    // 写入 trace 的最后一条记录（在状态回调中调用）
+    void write(const TraceLog& trace);
+    // 写入一个完整状态（没有增量信息时使用，内存按完整快照写出）
+    void write(const ArchState& state);
+    void finish() { flush(); }
+    void flush();
+
+private:
+    void writeRecord(const ArchState& state, uint8_t flags, uint32_t mem_count);
+    void putU64(uint64_t val);
+    void put(const uint8_t* data, size_t len);
+
+    FILE* out_;
+    std::vector<uint8_t> buf_;
+};
+
+// 二进制状态读取器：逐条读入并应用内存增量，维护当前完整状态
+class BinaryTraceReader {
+public:
+    // 读取并检查文件头，格式不正确时抛出 std::runtime_error
+    explicit BinaryTraceReader(FILE* in);
+
+    // 读取下一条记录；文件结束时返回 false，记录不完整时抛出 std::runtime_error
+    bool next();
+    const ArchState& state() const { return state_; }
+
+private:
+    bool read(uint8_t* data, size_t len);
+
+    FILE* in_;
+    ArchState state_;
+    std::vector<uint8_t> mem_buf_;
+};
+
+#endif // BINARY_TRACE_H
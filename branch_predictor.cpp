@@ -0,0 +1,119 @@
+#include "branch_predictor.h"
+#include <algorithm>
+
+namespace {
+    // 向上取整到2的幂
+    size_t roundUpPow2(size_t n) {
+        size_t size = 1;
+        while (size < n) size <<= 1;
+        return size;
+    }
+}
+
+// OneBitPredictor 实现
+OneBitPredictor::OneBitPredictor(size_t entries)
+    : table_(roundUpPow2(entries), 0), mask_(roundUpPow2(entries) - 1) {
+}
+
+bool OneBitPredictor::predict(uint64_t pc, uint64_t, bool) {
+    return table_[pc & mask_] != 0;
+}
+
+void OneBitPredictor::update(uint64_t pc, uint64_t, bool taken) {
+    table_[pc & mask_] = taken ? 1 : 0;
+}
+
+void OneBitPredictor::reset() {
+    std::fill(table_.begin(), table_.end(), 0);
+}
+
+// TwoBitPredictor 实现（初始为弱不跳转）
+TwoBitPredictor::TwoBitPredictor(size_t entries)
+    : counters_(roundUpPow2(entries), 1), mask_(roundUpPow2(entries) - 1) {
+}
+
+bool TwoBitPredictor::predict(uint64_t pc, uint64_t, bool) {
+    return counters_[pc & mask_] >= 2;
+}
+
+void TwoBitPredictor::update(uint64_t pc, uint64_t, bool taken) {
+    uint8_t& counter = counters_[pc & mask_];
+    if (taken) {
+        if (counter < 3) counter++;
+    } else {
+        if (counter > 0) counter--;
+    }
+}
+
+void TwoBitPredictor::reset() {
+    std::fill(counters_.begin(), counters_.end(), 1);
+}
+
+// GsharePredictor 实现
+GsharePredictor::GsharePredictor(unsigned history_bits, size_t btb_entries)
+    : counters_(size_t(1) << history_bits, 1), mask_((uint64_t(1) << history_bits) - 1),
+      btb_(roundUpPow2(btb_entries)), btb_mask_(roundUpPow2(btb_entries) - 1) {
+}
+
+bool GsharePredictor::predict(uint64_t pc, uint64_t, bool) {
+    const BTBEntry& entry = btb_[pc & btb_mask_];
+    if (!entry.valid || entry.tag != pc) {
+        return false;  // 没有跳转过的分支按不跳转预测
+    }
+    return counters_[index(pc)] >= 2;
+}
+
+void GsharePredictor::update(uint64_t pc, uint64_t, bool taken) {
+    uint8_t& counter = counters_[index(pc)];
+    if (taken) {
+        if (counter < 3) counter++;
+        BTBEntry& entry = btb_[pc & btb_mask_];
+        entry.valid = true;
+        entry.tag = pc;
+    } else {
+        if (counter > 0) counter--;
+    }
+    history_ = ((history_ << 1) | (taken ? 1 : 0)) & mask_;
+}
+
+void GsharePredictor::reset() {
+    std::fill(counters_.begin(), counters_.end(), 1);
+    for (auto& entry : btb_) {
+        entry = BTBEntry();
+    }
+    history_ = 0;
+}
+
+// ReturnAddressStack 实现
+ReturnAddressStack::ReturnAddressStack(size_t depth) : entries_(depth, 0) {
+}
+
+void ReturnAddressStack::push(uint64_t addr) {
+    if (entries_.empty()) return;
+    entries_[top_] = addr;
+    top_ = (top_ + 1) % entries_.size();
+    if (count_ < entries_.size()) count_++;
+}
+
+bool ReturnAddressStack::pop(uint64_t& addr) {
+    if (count_ == 0) return false;
+    top_ = (top_ + entries_.size() - 1) % entries_.size();
+    addr = entries_[top_];
+    count_--;
+    return true;
+}
+
+void ReturnAddressStack::reset() {
+    std::fill(entries_.begin(), entries_.end(), 0);
+    top_ = 0;
+    count_ = 0;
+}
+
+std::unique_ptr<BranchPredictor> makeBranchPredictor(const std::string& name) {
+    if (name == "nt") return std::unique_ptr<BranchPredictor>(new NotTakenPredictor());
+    if (name == "btfn") return std::unique_ptr<BranchPredictor>(new BTFNPredictor());
+    if (name == "1bit") return std::unique_ptr<BranchPredictor>(new OneBitPredictor());
+    if (name == "2bit") return std::unique_ptr<BranchPredictor>(new TwoBitPredictor());
+    if (name == "gshare") return std::unique_ptr<BranchPredictor>(new GsharePredictor());
+    return nullptr;
+}
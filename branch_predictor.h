@@ -0,0 +1,122 @@
+#ifndef BRANCH_PREDICTOR_H
+#define BRANCH_PREDICTOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// JXX分支预测器接口
+// 取指阶段调用 predict() 决定下一条取指地址，执行阶段得到 Cnd 后调用 update()
+class BranchPredictor {
+public:
+    virtual ~BranchPredictor() = default;
+    
+    // 预测 pc 处的条件跳转是否跳转；target 为译码得到的跳转目标，
+    // unconditional 表示 jmp（ifun=0）
+    virtual bool predict(uint64_t pc, uint64_t target, bool unconditional) = 0;
+    // 用实际结果更新预测器状态
+    virtual void update(uint64_t pc, uint64_t target, bool taken) = 0;
+    // 清空预测器状态（加载新程序时调用）
+    virtual void reset() = 0;
+    virtual std::string name() const = 0;
+};
+
+// 总是预测不跳转（原始流水线的行为）
+class NotTakenPredictor : public BranchPredictor {
+public:
+    bool predict(uint64_t, uint64_t, bool) override { return false; }
+    void update(uint64_t, uint64_t, bool) override {}
+    void reset() override {}
+    std::string name() const override { return "nt"; }
+};
+
+// 静态预测：向后跳转（循环）预测跳转，向前跳转预测不跳转；jmp总是跳转
+class BTFNPredictor : public BranchPredictor {
+public:
+    bool predict(uint64_t pc, uint64_t target, bool unconditional) override {
+        return unconditional || target <= pc;
+    }
+    void update(uint64_t, uint64_t, bool) override {}
+    void reset() override {}
+    std::string name() const override { return "btfn"; }
+};
+
+// 1位预测：记住该分支上一次的结果
+class OneBitPredictor : public BranchPredictor {
+public:
+    explicit OneBitPredictor(size_t entries = 1024);
+    bool predict(uint64_t pc, uint64_t target, bool unconditional) override;
+    void update(uint64_t pc, uint64_t target, bool taken) override;
+    void reset() override;
+    std::string name() const override { return "1bit"; }
+
+private:
+    std::vector<uint8_t> table_;
+    uint64_t mask_;
+};
+
+// 2位饱和计数器（0/1预测不跳转，2/3预测跳转）
+class TwoBitPredictor : public BranchPredictor {
+public:
+    explicit TwoBitPredictor(size_t entries = 1024);
+    bool predict(uint64_t pc, uint64_t target, bool unconditional) override;
+    void update(uint64_t pc, uint64_t target, bool taken) override;
+    void reset() override;
+    std::string name() const override { return "2bit"; }
+
+private:
+    std::vector<uint8_t> counters_;
+    uint64_t mask_;
+};
+
+// gshare：全局历史与PC异或索引2位计数器，另有一张按PC打标签的表（模拟BTB）
+// 记录曾经跳转过的分支，只有命中时才预测跳转。Y86的JXX都是直接跳转，目标就是
+// 取指阶段译码出的 valC，所以表中只保存标签，不保存目标地址。
+class GsharePredictor : public BranchPredictor {
+public:
+    explicit GsharePredictor(unsigned history_bits = 10, size_t btb_entries = 256);
+    bool predict(uint64_t pc, uint64_t target, bool unconditional) override;
+    void update(uint64_t pc, uint64_t target, bool taken) override;
+    void reset() override;
+    std::string name() const override { return "gshare"; }
+
+private:
+    struct BTBEntry {
+        bool valid = false;
+        uint64_t tag = 0;
+    };
+    
+    size_t index(uint64_t pc) const { return (pc ^ history_) & mask_; }
+    
+    std::vector<uint8_t> counters_;
+    uint64_t mask_;
+    uint64_t history_ = 0;
+    std::vector<BTBEntry> btb_;
+    uint64_t btb_mask_;
+};
+
+// 返回地址栈（RAS）
+// 取指阶段遇到CALL压入返回地址、遇到RET弹出作为预测的下一条PC。
+// 栈满时覆盖最旧的条目，栈空时无法预测。
+class ReturnAddressStack {
+public:
+    explicit ReturnAddressStack(size_t depth = 0);
+    
+    void push(uint64_t addr);
+    // 弹出栈顶；栈空时返回 false
+    bool pop(uint64_t& addr);
+    void reset();
+    size_t depth() const { return entries_.size(); }
+    bool enabled() const { return !entries_.empty(); }
+
+private:
+    std::vector<uint64_t> entries_;  // 循环缓冲区
+    size_t top_ = 0;                 // 下一次压入的位置
+    size_t count_ = 0;               // 有效条目数
+};
+
+// 按名字创建预测器：nt / btfn / 1bit / 2bit / gshare，未知名字返回 nullptr
+std::unique_ptr<BranchPredictor> makeBranchPredictor(const std::string& name);
+
+#endif // BRANCH_PREDICTOR_H
@@ -0,0 +1,173 @@
+#include "cache.h"
+#include <stdexcept>
+
+namespace {
+
+// 解析非负整数，支持 K/M 后缀
+bool parseNumber(const std::string& text, uint64_t& out) {
+    size_t pos = 0;
+    uint64_t val = 0;
+    try {
+        if (text.empty() || text[0] == '-') return false;
+        val = std::stoull(text, &pos, 10);
+    } catch (const std::logic_error&) {
+        return false;
+    }
+    std::string suffix = text.substr(pos);
+    if (suffix == "K" || suffix == "k") val <<= 10;
+    else if (suffix == "M" || suffix == "m") val <<= 20;
+    else if (!suffix.empty()) return false;
+    out = val;
+    return true;
+}
+
+const char* const REPLACEMENT_NAMES[] = {"lru", "fifo", "random"};
+
+}  // namespace
+
+void Cache::Config::parse(const std::string& spec) {
+    Config parsed = *this;
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t eq = item.find('=');
+        std::string key = item.substr(0, eq);
+        std::string value = (eq == std::string::npos) ? "" : item.substr(eq + 1);
+        uint64_t number = 0;
+        bool ok = true;
+        if (key == "size") {
+            ok = parseNumber(value, number) && number > 0;
+            parsed.size = number;
+        } else if (key == "assoc") {
+            ok = parseNumber(value, number) && number > 0 && number <= 64;
+            parsed.assoc = static_cast<unsigned>(number);
+        } else if (key == "line") {
+            ok = parseNumber(value, number) && number >= 8 && number <= 4096 &&
+                 (number & (number - 1)) == 0;
+            parsed.line_size = static_cast<unsigned>(number);
+        } else if (key == "penalty") {
+            ok = parseNumber(value, number) && number <= 1000;
+            parsed.miss_penalty = static_cast<unsigned>(number);
+        } else if (key == "policy") {
+            if (value == "lru") parsed.replacement = LRU;
+            else if (value == "fifo") parsed.replacement = FIFO;
+            else if (value == "random") parsed.replacement = RANDOM;
+            else ok = false;
+        } else if (key == "write") {
+            if (value == "back") parsed.write_back = true;
+            else if (value == "through") parsed.write_back = false;
+            else ok = false;
+        } else {
+            throw std::runtime_error("unknown cache option '" + item + "' in " + spec +
+                                     " (expected size, assoc, line, policy, write or penalty)");
+        }
+        if (!ok) {
+            throw std::runtime_error("invalid cache option '" + item + "' in " + spec);
+        }
+    }
+    uint64_t set_bytes = static_cast<uint64_t>(parsed.assoc) * parsed.line_size;
+    if (parsed.size % set_bytes != 0) {
+        throw std::runtime_error("cache size " + std::to_string(parsed.size) +
+                                 " is not a multiple of assoc * line (" +
+                                 std::to_string(set_bytes) + ")");
+    }
+    *this = parsed;
+}
+
+std::string Cache::Config::describe() const {
+    std::string text = (size % 1024 == 0) ? std::to_string(size / 1024) + "K" : std::to_string(size);
+    text += ", " + std::to_string(assoc) + "-way, " + std::to_string(line_size) + "B lines, ";
+    text += REPLACEMENT_NAMES[replacement];
+    text += write_back ? ", write-back" : ", write-through";
+    text += ", miss penalty " + std::to_string(miss_penalty);
+    return text;
+}
+
+Cache::Cache(const Config& config) : config_(config) {
+    uint64_t set_bytes = static_cast<uint64_t>(config_.assoc) * config_.line_size;
+    if (config_.assoc == 0 || config_.line_size == 0 ||
+        (config_.line_size & (config_.line_size - 1)) != 0 ||
+        config_.size == 0 || config_.size % set_bytes != 0) {
+        throw std::runtime_error("invalid cache geometry");
+    }
+    sets_ = config_.size / set_bytes;
+    while ((1u << line_shift_) < config_.line_size) line_shift_++;
+    reset();
+}
+
+void Cache::reset() {
+    lines_.assign(sets_ * config_.assoc, Line());
+    clock_ = 0;
+    rng_ = 0x9E3779B97F4A7C15ull;
+    stats_ = Stats();
+}
+
+unsigned Cache::access(uint64_t addr, unsigned len, bool write) {
+    uint64_t first = addr >> line_shift_;
+    uint64_t last = (addr + (len ? len - 1 : 0)) >> line_shift_;
+    unsigned missed = 0;
+    for (uint64_t line = first; ; line++) {
+        if (accessLine(line, write)) missed++;
+        if (line == last) break;
+    }
+
+    if (write) {
+        stats_.writes++;
+        if (missed) stats_.write_misses++;
+        if (!config_.write_back) {
+            // 写直达不写分配：写缺失不填入，直接写存储器
+            stats_.write_throughs++;
+            return 0;
+        }
+    } else {
+        stats_.reads++;
+        if (missed) stats_.read_misses++;
+    }
+    return missed * config_.miss_penalty;
+}
+
+bool Cache::accessLine(uint64_t line_addr, bool write) {
+    clock_++;
+    uint64_t tag = line_addr / sets_;
+    Line* set = &lines_[(line_addr % sets_) * config_.assoc];
+    for (unsigned way = 0; way < config_.assoc; way++) {
+        Line& line = set[way];
+        if (line.valid && line.tag == tag) {
+            if (config_.replacement == LRU) line.stamp = clock_;
+            if (write && config_.write_back) line.dirty = true;
+            return false;
+        }
+    }
+    if (write && !config_.write_back) {
+        return true;
+    }
+
+    // 缺失：优先使用空行，否则按替换策略选择
+    Line* victim = nullptr;
+    for (unsigned way = 0; way < config_.assoc && !victim; way++) {
+        if (!set[way].valid) victim = &set[way];
+    }
+    if (!victim) {
+        if (config_.replacement == RANDOM) {
+            rng_ ^= rng_ << 13;
+            rng_ ^= rng_ >> 7;
+            rng_ ^= rng_ << 17;
+            victim = &set[rng_ % config_.assoc];
+        } else {
+            victim = set;
+            for (unsigned way = 1; way < config_.assoc; way++) {
+                if (set[way].stamp < victim->stamp) victim = &set[way];
+            }
+        }
+        if (victim->dirty) stats_.writebacks++;
+    }
+    victim->tag = tag;
+    victim->stamp = clock_;
+    victim->valid = true;
+    victim->dirty = write;
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 组相联高速缓存的时序模型
+//
+// 只记录每行的标签和状态，数据仍然读写 Memory，所以加入缓存只改变周期数，不改变
+// 体系结构状态。写策略为写回+写分配，或写直达+不写分配（写直达的写入和写回的脏行
+// 都经过写缓冲，不产生停顿）；一次访问跨越两行时分别查找，每个缺失的行停顿 miss_penalty 个周期。
+class Cache {
+public:
+    enum Replacement : uint8_t { LRU, FIFO, RANDOM };
+
+    struct Config {
+        uint64_t size = 4096;         // 总容量（字节）
+        unsigned assoc = 2;           // 每组的行数
+        unsigned line_size = 32;      // 行大小（字节，2的幂）
+        Replacement replacement = LRU;
+        bool write_back = true;       // false 为写直达
+        unsigned miss_penalty = 10;   // 每个缺失的行额外停顿的周期数
+
+        // 解析 "size=4K,assoc=2,line=32,policy=lru,write=back,penalty=10"（未给出的项保持默认），
+        // 格式错误或容量不能整除成组时抛出 std::runtime_error
+        void parse(const std::string& spec);
+        std::string describe() const;
+    };
+
+    struct Stats {
+        uint64_t reads = 0;
+        uint64_t read_misses = 0;
+        uint64_t writes = 0;
+        uint64_t write_misses = 0;
+        uint64_t writebacks = 0;      // 被替换的脏行（写回）
+        uint64_t write_throughs = 0;  // 直接写入存储器的写操作（写直达）
+        uint64_t accesses() const { return reads + writes; }
+        uint64_t misses() const { return read_misses + write_misses; }
+        double missRate() const {
+            return accesses() ? static_cast<double>(misses()) / accesses() : 0.0;
+        }
+    };
+
+    explicit Cache(const Config& config);
+
+    // 清空所有行和统计（加载新程序时调用）
+    void reset();
+    // 访问 [addr, addr+len)，返回需要停顿的周期数（全部命中为0）
+    unsigned access(uint64_t addr, unsigned len, bool write);
+    const Stats& stats() const { return stats_; }
+    const Config& config() const { return config_; }
+
+private:
+    struct Line {
+        uint64_t tag = 0;
+        uint64_t stamp = 0;  // LRU 为最近访问时间，FIFO 为填入时间
+        bool valid = false;
+        bool dirty = false;
+    };
+
+    // 访问地址所在的一行，缺失时返回 true
+    bool accessLine(uint64_t line_addr, bool write);
+
+    Config config_;
+    uint64_t sets_ = 0;
+    unsigned line_shift_ = 0;
+    std::vector<Line> lines_;  // sets_ 组，每组 assoc 行
+    uint64_t clock_ = 0;
+    uint64_t rng_ = 0;
+    Stats stats_;
+};
+
+#endif // CACHE_H
@@ -1,4 +1,13 @@
 #include "pipeline.h"
+#include "functional.h"
+#include "timing.h"
+#include "ooo.h"
+#include "output.h"
+#include "loader.h"
+#include "batch.h"
+#include "verify.h"
+#include "ybo.h"
+#include "binary_trace.h"
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -6,164 +15,736 @@
 #include <map>
 #include <iomanip>
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
-#include <iomanip>
+#include <memory>
+
+// 打印用法
+void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options] < program.yo|program.ybo" << std::endl;
+    std::cerr << "       " << prog << " --batch [options] FILE.yo|FILE.ybo|DIR..." << std::endl;
+    std::cerr << "  --engine=pipeline    五级流水线周期级模拟（默认）" << std::endl;
+    std::cerr << "  --engine=functional  功能级模拟，每步执行一条指令，不建模周期" << std::endl;
+    std::cerr << "  --engine=timing      功能级模拟驱动的可配置顺序流水线时序模型，输出CPI分解" << std::endl;
+    std::cerr << "  --engine=ooo         功能级模拟驱动的Tomasulo乱序执行核心时序模型（ROB、保留站、LSQ）" << std::endl;
+    std::cerr << "  --stages=LIST        时序模型的流水线级，如 F,F,D,E,M:2,W（字母为级类别，:N 为该级延迟，默认 F,D,E,M,W）" << std::endl;
+    std::cerr << "  --alu-latency=N      时序/乱序模型中OPQ在执行阶段占用的周期数" << std::endl;
+    std::cerr << "  --issue-width=N      时序模型的发射宽度（默认1，2为双发射顺序流水线）；乱序模型的取指/分派/提交宽度（默认2）" << std::endl;
+    std::cerr << "  --rob=N --rs=N --lsq=N  乱序模型的重排序缓冲、保留站和访存队列项数（默认32/16/16）" << std::endl;
+    std::cerr << "  --quiet              不输出JSON状态（只输出统计，用于测量模拟吞吐量）" << std::endl;
+    std::cerr << "  --trace-format=FMT   状态输出格式：json（默认）/binary（定长记录+内存增量）" << std::endl;
+    std::cerr << "  --json-from-binary=FILE  把二进制状态文件转换为JSON输出，不运行模拟" << std::endl;
+    std::cerr << "  --verify FILE        与答案JSON逐状态比较（不输出JSON），在第一个不一致处停止并报告差异" << std::endl;
+    std::cerr << "  --predictor=NAME     JXX分支预测器：nt（默认，总是不跳转）/btfn/1bit/2bit/gshare" << std::endl;
+    std::cerr << "  --ras=DEPTH          返回地址栈深度（0-4096），0 表示不使用（默认）" << std::endl;
+    std::cerr << "  --load-bypass        启用访存->执行旁路，代替Load/Use停顿" << std::endl;
+    std::cerr << "  --profile=FILE       按PC统计周期/停顿/冲刷，输出平坦剖析、调用图和带计数的源程序" << std::endl;
+    std::cerr << "  --stats-json=FILE    把详细性能计数器（按icode/寄存器/分支PC/转发来源等）以JSON写入FILE" << std::endl;
+    std::cerr << "  --cycle-trace=FILE   记录每个周期各阶段的指令和停顿/气泡/冲刷/转发，以紧凑文本写入FILE" << std::endl;
+    std::cerr << "  --cycle-trace-chrome=FILE  同上，以Chrome trace-event JSON格式写入FILE" << std::endl;
+    std::cerr << "  --cycle-trace-size=N 周期跟踪环形缓冲区大小，只保留最后N个周期（默认64K，最大16M）" << std::endl;
+    std::cerr << "  --icache[=SPEC] --dcache[=SPEC]  在流水线的取指/访存阶段加入指令/数据缓存，SPEC 如" << std::endl;
+    std::cerr << "                       size=4K,assoc=2,line=32,policy=lru|fifo|random,write=back|through,penalty=10" << std::endl;
+    std::cerr << "  --mem-size=SIZE      地址空间大小，支持K/M/G后缀，full表示完整64位地址空间（默认1M）" << std::endl;
+    std::cerr << "  --mem-cap=SIZE       最多驻留的内存大小（按4KB页计），超出时按地址错误处理" << std::endl;
+    std::cerr << "  --emit-ybo=FILE      把输入程序（.yo 或 .ybo）转换为 .ybo 二进制格式写入FILE，不运行模拟" << std::endl;
+    std::cerr << "  --batch              批量模式：在一个进程内用线程池模拟所有给定的程序" << std::endl;
+    std::cerr << "  --out=DIR            批量模式的输出目录（默认 batch_out）" << std::endl;
+    std::cerr << "  -j N, --jobs=N       批量模式的线程数（默认为硬件线程数）" << std::endl;
+}
+
+// 解析带K/M/G后缀的大小，负数、格式错误或乘上后缀后溢出时返回false
+bool parseSize(const std::string& text, uint64_t& out) {
+    if (text == "full") {
+        out = Memory::FULL_ADDRESS_SPACE;
+        return true;
+    }
+    // stoull 会跳过空白并接受正负号，要求以数字开头
+    if (text.empty() || text[0] < '0' || text[0] > '9') return false;
+    size_t pos = 0;
+    uint64_t val = 0;
+    try {
+        val = std::stoull(text, &pos, 0);
+    } catch (...) {
+        return false;
+    }
+    std::string suffix = text.substr(pos);
+    unsigned shift = 0;
+    if (suffix == "K" || suffix == "k") shift = 10;
+    else if (suffix == "M" || suffix == "m") shift = 20;
+    else if (suffix == "G" || suffix == "g") shift = 30;
+    else if (!suffix.empty()) return false;
+    if (val > (UINT64_MAX >> shift)) return false;
+    out = val << shift;
+    return true;
+}
 
-// JSON输出辅助函数
-void outputJSON(const PipelineSimulator::State& state) {
-    std::cout << "    {\n";
-    
-    // PC
-    std::cout << "        \"PC\": " << state.PC << ",\n";
-    
-    // REG
-    std::cout << "        \"REG\": {\n";
-    bool first_reg = true;
-    for (int i = 0; i < 15; i++) {
-        if (!first_reg) std::cout << ",\n";
-        std::string regName = Y86::getRegName(i);
-        std::cout << "            \"" << regName << "\": " << state.regs.get(i);
-        first_reg = false;
-    }
-    std::cout << "\n        },\n";
-    
-    // MEM
-    std::cout << "        \"MEM\": {\n";
-    bool first_mem = true;
-    for (const auto& pair : state.mem_snapshot) {
-        if (!first_mem) std::cout << ",\n";
-        std::cout << "            \"" << pair.first << "\": " << pair.second;
-        first_mem = false;
-    }
-    std::cout << "\n        },\n";
-    
-    // CC
-    std::cout << "        \"CC\": {\n";
-    std::cout << "            \"ZF\": " << (state.CC.ZF ? 1 : 0) << ",\n";
-    std::cout << "            \"SF\": " << (state.CC.SF ? 1 : 0) << ",\n";
-    std::cout << "            \"OF\": " << (state.CC.OF ? 1 : 0) << "\n";
-    std::cout << "        },\n";
-    
-    // STAT
-    std::cout << "        \"STAT\": " << static_cast<int>(state.STAT) << "\n";
-    
-    std::cout << "    }";
+// 输出模拟耗时和吞吐量（用于比较两种模拟引擎）
+void printThroughput(uint64_t instructions, double seconds) {
+    std::cerr << "Simulation Time (ms): " << std::fixed << std::setprecision(3)
+              << seconds * 1000.0 << std::endl;
+    double ips = (seconds > 0) ? instructions / seconds : 0.0;
+    std::cerr << "Throughput (instructions/s): " << std::fixed << std::setprecision(0)
+              << ips << std::endl;
+}
+
+// 输出校验结果（到stdout），返回进程退出码
+int reportVerify(TraceVerifier& verifier) {
+    if (verifier.finish()) {
+        std::cout << "Verify: OK (" << verifier.compared() << " states)" << std::endl;
+        return 0;
+    }
+    std::cout << "Verify: FAILED" << std::endl;
+    std::cout << verifier.message() << std::endl;
+    return 1;
 }
 
-// 解析.yo文件格式
-std::vector<uint8_t> parseYoFile(std::istream& input) {
-    // 使用map来存储地址到字节的映射，然后转换为vector
-    std::map<uint64_t, uint8_t> addr_map;
-    std::string line;
+// 状态输出方式
+struct OutputOptions {
+    bool quiet = false;              // 不输出状态
+    bool binary = false;             // 二进制格式（默认JSON）
+    TraceVerifier* verifier = nullptr;  // 非空时与答案比较，不输出状态
+};
+
+// 按输出方式挂接状态回调并运行模拟器，返回模拟耗时（秒）
+template <typename Simulator>
+double runWithOutput(Simulator& simulator, const OutputOptions& output) {
+    // 每条指令退休时直接序列化输出，不保留历史状态
+    simulator.setRecordTrace(false);
+    std::unique_ptr<JsonTraceWriter> json;
+    std::unique_ptr<BinaryTraceWriter> binary;
+    if (output.verifier) {
+        // 校验模式：发现第一个不一致就停止模拟
+        TraceVerifier* verifier = output.verifier;
+        simulator.setStateSink([verifier, &simulator](const typename Simulator::State& state) {
+            if (!verifier->check(state)) simulator.requestStop();
+        });
+    } else if (output.quiet) {
+        // 不输出状态
+    } else if (output.binary) {
+        binary.reset(new BinaryTraceWriter(stdout));
+        BinaryTraceWriter* writer = binary.get();
+        simulator.setStateSink([writer, &simulator](const typename Simulator::State&) {
+            writer->write(simulator.getTrace());
+        });
+    } else {
+        json.reset(new JsonTraceWriter(stdout));
+        JsonTraceWriter* writer = json.get();
+        simulator.setStateSink([writer](const typename Simulator::State& state) {
+            writer->write(state);
+        });
+    }
     
-    while (std::getline(input, line)) {
-        // 跳过注释和空行
-        if (line.empty() || line[0] == '#' || line.find('|') == std::string::npos) {
-            continue;
+    auto start = std::chrono::steady_clock::now();
+    simulator.run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (json) json->finish();
+    if (binary) binary->finish();
+    return elapsed.count();
+}
+
+// 流水线引擎的微结构配置和周期级跟踪选项
+struct PipelineOptions {
+    std::string predictor = "nt";
+    size_t ras_depth = 0;
+    bool load_bypass = false;
+    std::string cycle_trace_path;         // 紧凑文本格式
+    std::string cycle_trace_chrome_path;  // Chrome trace-event JSON
+    size_t cycle_trace_size = CycleTracer::DEFAULT_CAPACITY;
+    std::string stats_json_path;          // 详细性能计数器（JSON）
+    std::string profile_path;             // 按PC的热点分析报告
+    bool icache = false;
+    bool dcache = false;
+    Cache::Config icache_config;
+    Cache::Config dcache_config;
+};
+
+// 输出一个缓存的配置和命中/缺失统计
+void printCacheStats(const char* name, const Cache::Config& config, const Cache::Stats& stats,
+                     uint64_t stall_cycles) {
+    std::cerr << name << ": " << config.describe() << std::endl;
+    std::cerr << "  Reads: " << stats.reads << " (misses " << stats.read_misses << ")" << std::endl;
+    std::cerr << "  Writes: " << stats.writes << " (misses " << stats.write_misses << ")" << std::endl;
+    std::cerr << "  Miss Rate: " << std::fixed << std::setprecision(4) << stats.missRate() << std::endl;
+    std::cerr << "  Writebacks: " << stats.writebacks << std::endl;
+    std::cerr << "  Write-throughs: " << stats.write_throughs << std::endl;
+    std::cerr << "  Stall Cycles: " << stall_cycles << std::endl;
+}
+
+// 把周期级跟踪写入文件，失败返回false
+bool dumpCycleTrace(const CycleTracer& tracer, const std::string& path, bool chrome) {
+    std::unique_ptr<FILE, int (*)(FILE*)> out(std::fopen(path.c_str(), "w"), &std::fclose);
+    if (!out) {
+        std::cerr << "Error: Cannot write " << path << std::endl;
+        return false;
+    }
+    if (chrome) {
+        tracer.dumpChromeTrace(out.get());
+    } else {
+        tracer.dumpCompact(out.get());
+    }
+    return true;
+}
+
+// 把程序映像加载到模拟器；超出 --mem-cap 等错误时报告并返回 false
+template <typename Simulator>
+bool loadImage(Simulator& simulator, const ProgramImage& program) {
+    try {
+        simulator.loadProgram(program);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int runPipeline(const ProgramImage& program, const std::vector<SourceLine>& source,
+                const MemoryConfig& mem_config, const PipelineOptions& options,
+                const OutputOptions& output) {
+    // 创建模拟器并加载程序
+    PipelineSimulator simulator;
+    simulator.setMemoryConfig(mem_config);
+    simulator.setBranchPredictor(makeBranchPredictor(options.predictor));
+    simulator.setReturnAddressStackDepth(options.ras_depth);
+    simulator.setLoadUseBypass(options.load_bypass);
+    if (options.icache) simulator.setICache(options.icache_config);
+    if (options.dcache) simulator.setDCache(options.dcache_config);
+    if (!loadImage(simulator, program)) {
+        return 1;
+    }
+    
+    // 只在需要时分配环形缓冲区并挂接
+    std::unique_ptr<CycleTracer> tracer;
+    if (!options.cycle_trace_path.empty() || !options.cycle_trace_chrome_path.empty()) {
+        tracer.reset(new CycleTracer(options.cycle_trace_size));
+        simulator.setCycleTracer(tracer.get());
+    }
+    std::unique_ptr<Profiler> profiler;
+    if (!options.profile_path.empty()) {
+        profiler.reset(new Profiler());
+        simulator.setProfiler(profiler.get());
+    }
+    
+    // 运行模拟器
+    double seconds = runWithOutput(simulator, output);
+    
+    if (tracer) {
+        if (!options.cycle_trace_path.empty() &&
+            !dumpCycleTrace(*tracer, options.cycle_trace_path, false)) {
+            return 1;
         }
-        
-        // 找到冒号
-        size_t colon_pos = line.find(':');
-        if (colon_pos == std::string::npos) continue;
-        
-        // 提取地址（冒号前的部分）
-        std::string addr_str = line.substr(0, colon_pos);
-        // 移除0x前缀和空格
-        size_t hex_start = addr_str.find("0x");
-        if (hex_start == std::string::npos) continue;
-        addr_str = addr_str.substr(hex_start + 2);
-        // 移除空格
-        addr_str.erase(std::remove_if(addr_str.begin(), addr_str.end(), 
-                     [](char c) { return c == ' ' || c == '\t'; }), addr_str.end());
-        
-        uint64_t addr = 0;
-        try {
-            addr = std::stoull(addr_str, nullptr, 16);
-        } catch (...) {
-            continue;
+        if (!options.cycle_trace_chrome_path.empty() &&
+            !dumpCycleTrace(*tracer, options.cycle_trace_chrome_path, true)) {
+            return 1;
         }
-        
-        // 提取十六进制字节（冒号后到|之前的部分）
-        std::string hex_part = line.substr(colon_pos + 1);
-        // 移除注释部分（|之后的内容）
-        size_t pipe_pos = hex_part.find('|');
-        if (pipe_pos != std::string::npos) {
-            hex_part = hex_part.substr(0, pipe_pos);
+    }
+    
+    // 输出性能统计（到stderr，不影响JSON输出）
+    auto stats = simulator.getPerformanceStats();
+    std::cerr << "\n=== Performance Statistics ===" << std::endl;
+    std::cerr << "Total Cycles: " << stats.total_cycles << std::endl;
+    std::cerr << "Instructions Retired: " << stats.instructions_retired << std::endl;
+    std::cerr << "IPC (Instructions Per Cycle): " << std::fixed << std::setprecision(4) 
+              << stats.ipc << std::endl;
+    std::cerr << "Stall Cycles: " << stats.stall_cycles << std::endl;
+    std::cerr << "Load/Use Bypasses: " << stats.load_use_bypasses << std::endl;
+    std::cerr << "Bubble Cycles: " << stats.bubble_cycles << std::endl;
+    std::cerr << "Branch Predictor: " << simulator.getBranchPredictor().name() << std::endl;
+    std::cerr << "Branches: " << stats.branches << std::endl;
+    std::cerr << "Branch Mispredicts: " << stats.branch_mispredicts << std::endl;
+    std::cerr << "RAS Hits: " << stats.ras_hits << std::endl;
+    std::cerr << "RAS Misses: " << stats.ras_misses << std::endl;
+    std::cerr << "RET Flushes: " << stats.detail.ret_flushes << std::endl;
+    std::cerr << "Fill Cycles: " << stats.detail.fill_cycles << std::endl;
+    std::cerr << "Drain Cycles: " << stats.detail.drain_cycles << std::endl;
+    if (stats.has_icache) {
+        printCacheStats("I-Cache", options.icache_config, stats.icache, stats.icache_stall_cycles);
+    }
+    if (stats.has_dcache) {
+        printCacheStats("D-Cache", options.dcache_config, stats.dcache, stats.dcache_stall_cycles);
+    }
+    printThroughput(stats.instructions_retired, seconds);
+    
+    if (!options.stats_json_path.empty()) {
+        std::unique_ptr<FILE, int (*)(FILE*)> out(
+            std::fopen(options.stats_json_path.c_str(), "w"), &std::fclose);
+        if (!out) {
+            std::cerr << "Error: Cannot write " << options.stats_json_path << std::endl;
+            return 1;
         }
-        
-        // 移除所有空格
-        hex_part.erase(std::remove_if(hex_part.begin(), hex_part.end(), 
-                     [](char c) { return c == ' ' || c == '\t'; }), hex_part.end());
-        
-        // 按两个字符一组解析十六进制字节，加载到指定地址
-        for (size_t i = 0; i + 1 < hex_part.length(); i += 2) {
-            std::string hex_byte = hex_part.substr(i, 2);
-            try {
-                uint8_t byte = static_cast<uint8_t>(std::stoul(hex_byte, nullptr, 16));
-                addr_map[addr + (i / 2)] = byte;
-            } catch (...) {
-                // 忽略无效的十六进制
-                break;
-            }
+        try {
+            writeStatsJson(out.get(), stats, simulator.getBranchPredictor().name());
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
         }
     }
     
-    // 将地址映射转换为vector（找到最大地址）
-    uint64_t max_addr = 0;
-    for (const auto& pair : addr_map) {
-        if (pair.first > max_addr) {
-            max_addr = pair.first;
+    if (profiler) {
+        std::unique_ptr<FILE, int (*)(FILE*)> out(
+            std::fopen(options.profile_path.c_str(), "w"), &std::fclose);
+        if (!out) {
+            std::cerr << "Error: Cannot write " << options.profile_path << std::endl;
+            return 1;
         }
+        profiler->report(out.get(), source, stats.total_cycles);
+    }
+    
+    return output.verifier ? reportVerify(*output.verifier) : 0;
+}
+
+int runFunctional(const ProgramImage& program, const MemoryConfig& mem_config,
+                  const OutputOptions& output) {
+    FunctionalSimulator simulator;
+    simulator.setMemoryConfig(mem_config);
+    if (!loadImage(simulator, program)) {
+        return 1;
     }
     
-    // 创建vector，初始化为0
-    std::vector<uint8_t> program(max_addr + 1, 0);
+    double seconds = runWithOutput(simulator, output);
     
-    // 填充字节
-    for (const auto& pair : addr_map) {
-        if (pair.first < program.size()) {
-            program[pair.first] = pair.second;
+    auto stats = simulator.getPerformanceStats();
+    std::cerr << "\n=== Performance Statistics (functional) ===" << std::endl;
+    std::cerr << "Instructions Retired: " << stats.instructions_retired << std::endl;
+    printThroughput(stats.instructions_retired, seconds);
+    
+    return output.verifier ? reportVerify(*output.verifier) : 0;
+}
+
+int runTiming(const ProgramImage& program, const MemoryConfig& mem_config,
+              const PipelineModel::Config& config, const OutputOptions& output) {
+    FunctionalSimulator simulator;
+    simulator.setMemoryConfig(mem_config);
+    if (!loadImage(simulator, program)) {
+        return 1;
+    }
+    PipelineModel model(config);
+    simulator.setInstSink([&model](const RetiredInst& inst) { model.issue(inst); });
+    
+    double seconds = runWithOutput(simulator, output);
+    
+    const auto& stats = model.stats();
+    std::cerr << "\n=== Performance Statistics (timing model) ===" << std::endl;
+    std::cerr << "Pipeline Stages: " << config.describeStages() << std::endl;
+    if (config.alu_latency > 0) {
+        std::cerr << "ALU Latency: " << config.alu_latency << std::endl;
+    }
+    std::cerr << "Issue Width: " << config.width << std::endl;
+    std::cerr << "Total Cycles: " << stats.cycles << std::endl;
+    std::cerr << "Instructions Retired: " << stats.instructions << std::endl;
+    std::cerr << "IPC (Instructions Per Cycle): " << std::fixed << std::setprecision(4)
+              << (stats.cycles ? static_cast<double>(stats.instructions) / stats.cycles : 0.0) << std::endl;
+    std::cerr << "CPI: " << stats.cpi() << std::endl;
+    std::cerr << "Branch Predictor: " << config.predictor << std::endl;
+    std::cerr << "Branches: " << stats.branches << std::endl;
+    std::cerr << "Branch Mispredicts: " << stats.branch_mispredicts << std::endl;
+    std::cerr << "RAS Hits: " << stats.ras_hits << std::endl;
+    std::cerr << "RAS Misses: " << stats.ras_misses << std::endl;
+    if (stats.width > 1) {
+        std::cerr << "Bundles:";
+        for (unsigned size = 1; size <= stats.width; size++) {
+            std::cerr << " " << size << "-wide " << stats.bundle_sizes[size];
+        }
+        std::cerr << std::endl;
+        std::cerr << "Pairing Failures:" << std::endl;
+        for (int reason = 0; reason < PipelineModel::NUM_PAIR_FAILURES; reason++) {
+            std::cerr << "  " << std::left << std::setw(18)
+                      << PipelineModel::pairFailureName(static_cast<PipelineModel::PairFailure>(reason))
+                      << std::right << stats.pair_failures[reason] << std::endl;
         }
     }
+    // CPI分解：按退休槽位（每周期 width 个）计算，每条指令占1个槽位，
+    // 加上流水线填充和按原因归属的空闲槽位；单发射时槽位数即周期数
+    std::cerr << "CPI Breakdown:" << std::endl;
+    auto component = [&](const char* name, uint64_t slots) {
+        double cycles = static_cast<double>(slots) / stats.width;
+        double cpi = stats.instructions ? cycles / stats.instructions : 0.0;
+        std::cerr << "  " << std::left << std::setw(18) << name << std::right
+                  << std::setprecision(4) << cpi << "  (" << std::setprecision(stats.width > 1 ? 2 : 0)
+                  << cycles << " cycles)" << std::endl;
+    };
+    component("base", stats.instructions);
+    component("fill", stats.fill_cycles * stats.width);
+    for (int cause = PipelineModel::OTHER + 1; cause < PipelineModel::NUM_CAUSES; cause++) {
+        if (stats.width == 1 && (cause == PipelineModel::FETCH_BREAK || cause == PipelineModel::PAIRING)) {
+            continue;
+        }
+        component(PipelineModel::causeName(static_cast<PipelineModel::Cause>(cause)),
+                  stats.cause_slots[cause]);
+    }
+    component("other", stats.cause_slots[PipelineModel::OTHER] + stats.tail_slots);
+    printThroughput(stats.instructions, seconds);
     
-    return program;
+    return output.verifier ? reportVerify(*output.verifier) : 0;
 }
 
-int main() {
+int runOutOfOrder(const ProgramImage& program, const MemoryConfig& mem_config,
+                  const OutOfOrderModel::Config& config, const PipelineModel::Config& reference,
+                  const OutputOptions& output) {
+    FunctionalSimulator simulator;
+    simulator.setMemoryConfig(mem_config);
+    if (!loadImage(simulator, program)) {
+        return 1;
+    }
+    // 同一指令流同时送入五级流水线的时序模型，便于直接比较周期数
+    OutOfOrderModel model(config);
+    PipelineModel in_order(reference);
+    simulator.setInstSink([&](const RetiredInst& inst) {
+        model.issue(inst);
+        in_order.issue(inst);
+    });
+    
+    double seconds = runWithOutput(simulator, output);
+    
+    const auto& stats = model.stats();
+    std::cerr << "\n=== Performance Statistics (out-of-order model) ===" << std::endl;
+    std::cerr << "Width: " << config.width << std::endl;
+    std::cerr << "ROB/RS/LSQ Entries: " << config.rob_size << "/" << config.rs_size << "/"
+              << config.lsq_size << std::endl;
+    std::cerr << "ALU Latency: " << config.alu_latency << std::endl;
+    std::cerr << "Total Cycles: " << stats.cycles << std::endl;
+    std::cerr << "Instructions Retired: " << stats.instructions << std::endl;
+    std::cerr << "IPC (Instructions Per Cycle): " << std::fixed << std::setprecision(4)
+              << stats.ipc() << std::endl;
+    std::cerr << "CPI: " << stats.cpi() << std::endl;
+    std::cerr << "Branch Predictor: " << config.predictor << std::endl;
+    std::cerr << "Branches: " << stats.branches << std::endl;
+    std::cerr << "Branch Mispredicts: " << stats.branch_mispredicts << std::endl;
+    std::cerr << "RAS Hits: " << stats.ras_hits << std::endl;
+    std::cerr << "RAS Misses: " << stats.ras_misses << std::endl;
+    std::cerr << "Loads: " << stats.loads << std::endl;
+    std::cerr << "Stores: " << stats.stores << std::endl;
+    std::cerr << "Store-to-Load Forwards: " << stats.store_forwards << std::endl;
+    std::cerr << "Average ROB Occupancy: " << std::setprecision(2)
+              << (stats.instructions ? static_cast<double>(stats.rob_occupancy) / stats.instructions : 0.0)
+              << std::endl;
+    std::cerr << "Dispatch Stall Cycles:" << std::endl;
+    for (int s = 0; s < OutOfOrderModel::NUM_STRUCTURES; s++) {
+        std::cerr << "  " << std::left << std::setw(18)
+                  << OutOfOrderModel::structureName(static_cast<OutOfOrderModel::Structure>(s))
+                  << std::right << stats.dispatch_stalls[s] << std::endl;
+    }
+    const auto& base = in_order.stats();
+    std::cerr << "5-Stage Pipeline Cycles: " << base.cycles << std::endl;
+    std::cerr << "Speedup over 5-Stage: " << std::setprecision(4)
+              << (stats.cycles ? static_cast<double>(base.cycles) / stats.cycles : 0.0) << "x" << std::endl;
+    printThroughput(stats.instructions, seconds);
+    
+    return output.verifier ? reportVerify(*output.verifier) : 0;
+}
+
+// 把二进制状态文件转换为JSON（输出到stdout）
+int convertBinaryTrace(const std::string& path) {
+    std::unique_ptr<FILE, int (*)(FILE*)> in(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!in) {
+        std::cerr << "Error: Cannot open " << path << std::endl;
+        return 1;
+    }
+    try {
+        BinaryTraceReader reader(in.get());
+        JsonTraceWriter writer(stdout);
+        while (reader.next()) {
+            writer.write(reader.state());
+        }
+        writer.finish();
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::string engine = "pipeline";
+    OutputOptions output;
+    std::string binary_trace_path;
+    MemoryConfig mem_config;
+    PipelineOptions pipeline;
+    PipelineModel::Config timing;
+    OutOfOrderModel::Config ooo;
+    bool timing_options = false;  // 是否给出了只对时序模型有效的选项
+    bool model_options = false;   // 是否给出了对时序模型和乱序模型都有效的选项
+    bool ooo_options = false;     // 是否给出了只对乱序模型有效的选项
+    bool cycle_trace_options = false;  // 是否给出了周期跟踪选项（只对流水线引擎有效）
+    bool batch = false;
+    std::string verify_path;
+    std::string ybo_path;
+    BatchOptions batch_options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--engine=", 0) == 0) {
+            engine = arg.substr(9);
+        } else if (arg.rfind("--predictor=", 0) == 0) {
+            pipeline.predictor = arg.substr(12);
+            if (!makeBranchPredictor(pipeline.predictor)) {
+                std::cerr << "Error: Unknown branch predictor " << pipeline.predictor << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg.rfind("--ras=", 0) == 0) {
+            uint64_t depth = 0;
+            if (!parseSize(arg.substr(6), depth) || depth > 4096) {
+                std::cerr << "Error: Invalid RAS depth " << arg.substr(6) << std::endl;
+                return 1;
+            }
+            pipeline.ras_depth = static_cast<size_t>(depth);
+        } else if (arg == "--load-bypass") {
+            pipeline.load_bypass = true;
+        } else if (arg.rfind("--stages=", 0) == 0) {
+            try {
+                timing.parseStages(arg.substr(9));
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+            timing_options = true;
+        } else if (arg.rfind("--alu-latency=", 0) == 0) {
+            uint64_t latency = 0;
+            if (!parseSize(arg.substr(14), latency) || latency == 0 || latency > 1000) {
+                std::cerr << "Error: Invalid ALU latency " << arg.substr(14) << std::endl;
+                return 1;
+            }
+            timing.alu_latency = static_cast<unsigned>(latency);
+            ooo.alu_latency = static_cast<unsigned>(latency);
+            model_options = true;
+        } else if (arg.rfind("--issue-width=", 0) == 0) {
+            uint64_t width = 0;
+            if (!parseSize(arg.substr(14), width) || width == 0 || width > 8) {
+                std::cerr << "Error: Invalid issue width " << arg.substr(14) << " (expected 1..8)" << std::endl;
+                return 1;
+            }
+            timing.width = static_cast<unsigned>(width);
+            ooo.width = static_cast<unsigned>(width);
+            model_options = true;
+        } else if (arg.rfind("--rob=", 0) == 0 || arg.rfind("--rs=", 0) == 0 || arg.rfind("--lsq=", 0) == 0) {
+            size_t eq = arg.find('=');
+            uint64_t entries = 0;
+            if (!parseSize(arg.substr(eq + 1), entries) || entries == 0 || entries > 4096) {
+                std::cerr << "Error: Invalid " << arg.substr(2, eq - 2) << " size " << arg.substr(eq + 1)
+                          << " (expected 1..4096)" << std::endl;
+                return 1;
+            }
+            size_t& size = arg[2] == 'r' ? (arg[3] == 'o' ? ooo.rob_size : ooo.rs_size) : ooo.lsq_size;
+            size = static_cast<size_t>(entries);
+            ooo_options = true;
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            pipeline.profile_path = arg.substr(10);
+        } else if (arg.rfind("--stats-json=", 0) == 0) {
+            pipeline.stats_json_path = arg.substr(13);
+        } else if (arg.rfind("--cycle-trace=", 0) == 0) {
+            pipeline.cycle_trace_path = arg.substr(14);
+            cycle_trace_options = true;
+        } else if (arg.rfind("--cycle-trace-chrome=", 0) == 0) {
+            pipeline.cycle_trace_chrome_path = arg.substr(21);
+            cycle_trace_options = true;
+        } else if (arg == "--icache" || arg == "--dcache" ||
+                   arg.rfind("--icache=", 0) == 0 || arg.rfind("--dcache=", 0) == 0) {
+            bool data = (arg[2] == 'd');
+            try {
+                (data ? pipeline.dcache_config : pipeline.icache_config).parse(
+                    arg.size() > 8 ? arg.substr(9) : "");
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+            (data ? pipeline.dcache : pipeline.icache) = true;
+        } else if (arg.rfind("--cycle-trace-size=", 0) == 0) {
+            uint64_t size = 0;
+            if (!parseSize(arg.substr(19), size) || size == 0 || size > CycleTracer::MAX_CAPACITY) {
+                std::cerr << "Error: Invalid cycle trace size " << arg.substr(19) << std::endl;
+                return 1;
+            }
+            pipeline.cycle_trace_size = static_cast<size_t>(size);
+            cycle_trace_options = true;
+        } else if (arg == "--verify" || arg.rfind("--verify=", 0) == 0) {
+            if (arg == "--verify") {
+                if (i + 1 >= argc) {
+                    std::cerr << "Error: --verify requires an answer file" << std::endl;
+                    return 1;
+                }
+                verify_path = argv[++i];
+            } else {
+                verify_path = arg.substr(9);
+            }
+        } else if (arg.rfind("--emit-ybo=", 0) == 0) {
+            ybo_path = arg.substr(11);
+        } else if (arg == "--quiet") {
+            output.quiet = true;
+        } else if (arg.rfind("--trace-format=", 0) == 0) {
+            std::string format = arg.substr(15);
+            if (format != "json" && format != "binary") {
+                std::cerr << "Error: Unknown trace format " << format << std::endl;
+                return 1;
+            }
+            output.binary = (format == "binary");
+        } else if (arg.rfind("--json-from-binary=", 0) == 0) {
+            binary_trace_path = arg.substr(19);
+        } else if (arg.rfind("--mem-size=", 0) == 0) {
+            if (!parseSize(arg.substr(11), mem_config.size)) {
+                std::cerr << "Error: Invalid memory size " << arg.substr(11) << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--mem-cap=", 0) == 0) {
+            uint64_t cap = 0;
+            if (!parseSize(arg.substr(10), cap)) {
+                std::cerr << "Error: Invalid memory cap " << arg.substr(10) << std::endl;
+                return 1;
+            }
+            mem_config.max_pages = (cap + Memory::PAGE_SIZE - 1) / Memory::PAGE_SIZE;
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg.rfind("--out=", 0) == 0) {
+            batch_options.output_dir = arg.substr(6);
+        } else if (arg == "-j" || arg.rfind("--jobs=", 0) == 0) {
+            std::string value;
+            if (arg == "-j") {
+                if (i + 1 >= argc) {
+                    std::cerr << "Error: -j requires a thread count" << std::endl;
+                    return 1;
+                }
+                value = argv[++i];
+            } else {
+                value = arg.substr(7);
+            }
+            uint64_t jobs = 0;
+            if (!parseSize(value, jobs)) {
+                std::cerr << "Error: Invalid thread count " << value << std::endl;
+                return 1;
+            }
+            batch_options.jobs = static_cast<size_t>(jobs);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (batch && !arg.empty() && arg[0] != '-') {
+            batch_options.inputs.push_back(arg);
+        } else {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (engine != "pipeline" && engine != "functional" && engine != "timing" && engine != "ooo") {
+        std::cerr << "Error: Unknown engine " << engine << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (engine != "pipeline" && !pipeline.profile_path.empty()) {
+        std::cerr << "Error: --profile requires the pipeline engine" << std::endl;
+        return 1;
+    }
+    if ((engine != "pipeline" || batch) && !pipeline.stats_json_path.empty()) {
+        std::cerr << "Error: --stats-json requires the pipeline engine without --batch" << std::endl;
+        return 1;
+    }
+    if ((engine != "pipeline" || batch) && cycle_trace_options) {
+        std::cerr << "Error: --cycle-trace, --cycle-trace-chrome and --cycle-trace-size require "
+                     "the pipeline engine without --batch" << std::endl;
+        return 1;
+    }
+    if (engine != "pipeline" && (pipeline.icache || pipeline.dcache)) {
+        std::cerr << "Error: --icache and --dcache require the pipeline engine" << std::endl;
+        return 1;
+    }
+    if (engine != "timing" && timing_options) {
+        std::cerr << "Error: --stages requires the timing engine" << std::endl;
+        return 1;
+    }
+    if (engine != "timing" && engine != "ooo" && model_options) {
+        std::cerr << "Error: --alu-latency and --issue-width require the timing or ooo engine" << std::endl;
+        return 1;
+    }
+    if (engine != "ooo" && ooo_options) {
+        std::cerr << "Error: --rob, --rs and --lsq require the ooo engine" << std::endl;
+        return 1;
+    }
+    if (batch && (engine == "timing" || engine == "ooo")) {
+        std::cerr << "Error: --batch supports only the pipeline and functional engines" << std::endl;
+        return 1;
+    }
+    timing.predictor = pipeline.predictor;
+    timing.ras_depth = pipeline.ras_depth;
+    timing.load_bypass = pipeline.load_bypass;
+    ooo.predictor = pipeline.predictor;
+    ooo.ras_depth = pipeline.ras_depth;
+    
+    if (!binary_trace_path.empty()) {
+        return convertBinaryTrace(binary_trace_path);
+    }
+    
+    if (batch) {
+        if (batch_options.inputs.empty()) {
+            std::cerr << "Error: No input files for batch mode" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        batch_options.engine = engine;
+        batch_options.mem_config = mem_config;
+        batch_options.predictor = pipeline.predictor;
+        batch_options.ras_depth = pipeline.ras_depth;
+        batch_options.load_bypass = pipeline.load_bypass;
+        batch_options.icache = pipeline.icache;
+        batch_options.dcache = pipeline.dcache;
+        batch_options.icache_config = pipeline.icache_config;
+        batch_options.dcache_config = pipeline.dcache_config;
+        return runBatch(batch_options);
+    }
+    
     // 从stdin读取.yo格式文件
-    std::vector<uint8_t> program = parseYoFile(std::cin);
+    // 只有热点分析需要保留 .yo 的源文本
+    ProgramImage program;
+    std::vector<LoadDiagnostic> diagnostics;
+    std::vector<SourceLine> source;
+    try {
+        program = loadProgramStream(stdin, &diagnostics,
+                                    pipeline.profile_path.empty() ? nullptr : &source);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    for (const auto& diag : diagnostics) {
+        std::cerr << "Warning: line " << diag.line << ": " << diag.message << std::endl;
+    }
     
     if (program.empty()) {
         std::cerr << "Error: No program loaded" << std::endl;
         return 1;
     }
     
-    // 创建模拟器并加载程序
-    PipelineSimulator simulator;
-    simulator.loadProgram(program);
-    
-    // 运行模拟器
-    simulator.run();
-    
-    // 输出JSON结果
-    const auto& states = simulator.getStates();
-    std::cout << "[\n";
-    for (size_t i = 0; i < states.size(); i++) {
-        if (i > 0) std::cout << ",\n";
-        // 直接使用states[i]的引用，避免复制
-        outputJSON(states[i]);
+    if (!ybo_path.empty()) {
+        std::vector<uint8_t> data = Ybo::encode(program);
+        std::unique_ptr<FILE, int (*)(FILE*)> out(std::fopen(ybo_path.c_str(), "wb"), &std::fclose);
+        if (!out || std::fwrite(data.data(), 1, data.size(), out.get()) != data.size()) {
+            std::cerr << "Error: Cannot write " << ybo_path << std::endl;
+            return 1;
+        }
+        return 0;
     }
-    std::cout << "\n]" << std::endl;
     
-    // 输出性能统计（到stderr，不影响JSON输出）
-    auto stats = simulator.getPerformanceStats();
-    std::cerr << "\n=== Performance Statistics ===" << std::endl;
-    std::cerr << "Total Cycles: " << stats.total_cycles << std::endl;
-    std::cerr << "Instructions Retired: " << stats.instructions_retired << std::endl;
-    std::cerr << "IPC (Instructions Per Cycle): " << std::fixed << std::setprecision(4) 
-              << stats.ipc << std::endl;
-    std::cerr << "Stall Cycles: " << stats.stall_cycles << std::endl;
-    std::cerr << "Bubble Cycles: " << stats.bubble_cycles << std::endl;
+    std::unique_ptr<FILE, int (*)(FILE*)> answer(nullptr, &std::fclose);
+    std::unique_ptr<TraceVerifier> verifier;
+    if (!verify_path.empty()) {
+        answer.reset(std::fopen(verify_path.c_str(), "rb"));
+        if (!answer) {
+            std::cerr << "Error: Cannot open answer file " << verify_path << std::endl;
+            return 1;
+        }
+        verifier.reset(new TraceVerifier(answer.get()));
+        output.verifier = verifier.get();
+    }
     
-    return 0;
+    if (engine == "functional") {
+        return runFunctional(program, mem_config, output);
+    }
+    if (engine == "timing") {
+        return runTiming(program, mem_config, timing, output);
+    }
+    if (engine == "ooo") {
+        // 比较用的五级流水线使用相同的预测器、RAS 和旁路选项
+        PipelineModel::Config reference;
+        reference.predictor = timing.predictor;
+        reference.ras_depth = timing.ras_depth;
+        reference.load_bypass = timing.load_bypass;
+        return runOutOfOrder(program, mem_config, ooo, reference, output);
+    }
+    return runPipeline(program, source, mem_config, pipeline, output);
 }
@@ -0,0 +1,152 @@
+#include "cycle_trace.h"
+#include "y86.h"
+#include <cinttypes>
+
+namespace Forward {
+    const char* name(Source src) {
+        switch (src) {
+            case NONE: return "none";
+            case REGFILE: return "reg";
+            case E_M_VALE: return "e_valE";
+            case M_W_VALE: return "m_valE";
+            case M_W_VALM: return "m_valM";
+            case LOAD_BYPASS: return "bypass";
+            default: return "?";
+        }
+    }
+}
+
+namespace {
+
+const char* const STAGE_NAMES[CycleRecord::NUM_STAGES] = {"F", "D", "E", "M", "W"};
+
+struct EventName {
+    uint8_t bit;
+    const char* name;
+};
+const EventName EVENT_NAMES[] = {
+    {CycleEvent::STALL, "stall"},
+    {CycleEvent::BUBBLE, "bubble"},
+    {CycleEvent::RET_FLUSH, "ret_flush"},
+    {CycleEvent::JXX_FLUSH, "jxx_flush"},
+    {CycleEvent::LOAD_BYPASS, "load_bypass"},
+    {CycleEvent::RAS_HIT, "ras_hit"},
+    {CycleEvent::ICACHE_MISS, "icache_miss"},
+    {CycleEvent::DCACHE_MISS, "dcache_miss"},
+};
+
+void printSlot(FILE* out, const StageSlot& slot) {
+    if (slot.kind == StageSlot::EMPTY) {
+        std::fputs("-", out);
+    } else if (slot.kind == StageSlot::BUBBLE) {
+        std::fputs("bubble", out);
+    } else {
+        std::fprintf(out, "%s@0x%" PRIx64, Y86::getIcodeName(slot.icode), slot.pc);
+    }
+}
+
+bool sameSlot(const StageSlot& a, const StageSlot& b) {
+    return a.kind == b.kind && a.pc == b.pc && a.icode == b.icode;
+}
+
+}  // namespace
+
+CycleTracer::CycleTracer(size_t capacity) : records_(capacity > 0 ? capacity : 1) {
+}
+
+void CycleTracer::clear() {
+    head_ = 0;
+    size_ = 0;
+    total_ = 0;
+}
+
+const CycleRecord& CycleTracer::operator[](size_t i) const {
+    size_t oldest = (size_ < records_.size()) ? 0 : head_;
+    size_t index = oldest + i;
+    if (index >= records_.size()) index -= records_.size();
+    return records_[index];
+}
+
+// 每行：周期 F D E M W [事件...] [A=来源 B=来源]
+void CycleTracer::dumpCompact(FILE* out) const {
+    if (total_ > size_) {
+        std::fprintf(out, "# %" PRIu64 " cycles recorded, showing last %zu\n", total_, size_);
+    }
+    std::fputs("# cycle F D E M W events forwarding\n", out);
+    for (size_t i = 0; i < size_; i++) {
+        const CycleRecord& rec = (*this)[i];
+        std::fprintf(out, "%" PRIu64, rec.cycle);
+        for (int s = 0; s < CycleRecord::NUM_STAGES; s++) {
+            std::fputc(' ', out);
+            printSlot(out, rec.stage[s]);
+        }
+        for (const auto& ev : EVENT_NAMES) {
+            if (rec.events & ev.bit) std::fprintf(out, " %s", ev.name);
+        }
+        if (rec.fwd_A != Forward::NONE) {
+            std::fprintf(out, " A=%s", Forward::name(static_cast<Forward::Source>(rec.fwd_A)));
+        }
+        if (rec.fwd_B != Forward::NONE) {
+            std::fprintf(out, " B=%s", Forward::name(static_cast<Forward::Source>(rec.fwd_B)));
+        }
+        std::fputc('\n', out);
+    }
+}
+
+// 每个阶段一个线程（tid 0-4），同一条指令在一个阶段连续停留的周期合并为一个事件；
+// 控制事件作为 tid 5 上的瞬时事件。时间单位：1 周期 = 1 微秒
+void CycleTracer::dumpChromeTrace(FILE* out) const {
+    std::fputs("{\"traceEvents\":[\n", out);
+    bool first = true;
+    auto sep = [&]() {
+        if (!first) std::fputs(",\n", out);
+        first = false;
+    };
+    for (int s = 0; s < CycleRecord::NUM_STAGES; s++) {
+        sep();
+        std::fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+                     "\"args\":{\"name\":\"%s\"}}", s, STAGE_NAMES[s]);
+        sep();
+        std::fprintf(out, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+                     "\"args\":{\"sort_index\":%d}}", s, s);
+    }
+    sep();
+    std::fputs("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":5,"
+               "\"args\":{\"name\":\"events\"}}", out);
+
+    for (int s = 0; s < CycleRecord::NUM_STAGES; s++) {
+        size_t i = 0;
+        while (i < size_) {
+            const CycleRecord& start = (*this)[i];
+            const StageSlot& slot = start.stage[s];
+            size_t j = i + 1;
+            while (j < size_ && sameSlot((*this)[j].stage[s], slot)) j++;
+            if (slot.kind != StageSlot::EMPTY) {
+                sep();
+                if (slot.kind == StageSlot::BUBBLE) {
+                    std::fprintf(out, "{\"name\":\"bubble\",\"cat\":\"bubble\",\"ph\":\"X\",\"pid\":0,"
+                                 "\"tid\":%d,\"ts\":%" PRIu64 ",\"dur\":%zu}",
+                                 s, start.cycle, j - i);
+                } else {
+                    std::fprintf(out, "{\"name\":\"%s\",\"cat\":\"inst\",\"ph\":\"X\",\"pid\":0,"
+                                 "\"tid\":%d,\"ts\":%" PRIu64 ",\"dur\":%zu,"
+                                 "\"args\":{\"pc\":\"0x%" PRIx64 "\"}}",
+                                 Y86::getIcodeName(slot.icode), s, start.cycle, j - i, slot.pc);
+                }
+            }
+            i = j;
+        }
+    }
+
+    for (size_t i = 0; i < size_; i++) {
+        const CycleRecord& rec = (*this)[i];
+        for (const auto& ev : EVENT_NAMES) {
+            if (rec.events & ev.bit) {
+                sep();
+                std::fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":5,"
+                             "\"ts\":%" PRIu64 "}", ev.name, rec.cycle);
+            }
+        }
+    }
+    std::fputs("\n]}\n", out);
+}
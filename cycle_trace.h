@@ -0,0 +1,89 @@
+#ifndef CYCLE_TRACE_H
+#define CYCLE_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// 执行阶段操作数的来源（转发路径）
+namespace Forward {
+    enum Source : uint8_t {
+        NONE = 0,       // 指令不读这个操作数
+        REGFILE,        // 寄存器文件（没有转发）
+        E_M_VALE,       // E/M 中的 valE
+        M_W_VALE,       // M/W 中的 valE
+        M_W_VALM,       // M/W 中的 valM
+        LOAD_BYPASS,    // 访存->执行旁路（本周期M阶段读出的 valM）
+        NUM_SOURCES
+    };
+    const char* name(Source src);
+}
+
+// 一个周期内发生的流水线控制事件（位掩码）
+namespace CycleEvent {
+    constexpr uint8_t STALL = 1 << 0;        // Load/Use 停顿
+    constexpr uint8_t BUBBLE = 1 << 1;       // 控制冒险在 D/E 插入气泡
+    constexpr uint8_t RET_FLUSH = 1 << 2;    // RET 在M阶段得到返回地址，冲刷 F/D、D/E、E/M
+    constexpr uint8_t JXX_FLUSH = 1 << 3;    // 分支预测失败，冲刷 F/D、D/E
+    constexpr uint8_t LOAD_BYPASS = 1 << 4;  // 用访存->执行旁路代替停顿
+    constexpr uint8_t RAS_HIT = 1 << 5;      // RET 的返回地址被RAS正确预测
+    constexpr uint8_t ICACHE_MISS = 1 << 6;  // 取指阶段等待 I-cache 缺失
+    constexpr uint8_t DCACHE_MISS = 1 << 7;  // 访存阶段等待 D-cache 缺失，其后各阶段保持不变
+}
+
+// 一个流水线阶段在某个周期中保存的内容
+struct StageSlot {
+    enum Kind : uint8_t { EMPTY = 0, INST, BUBBLE };
+    uint64_t pc = 0;      // 气泡和空阶段为 0
+    uint8_t icode = 0;
+    uint8_t kind = EMPTY;
+};
+
+struct CycleRecord {
+    enum Stage { F = 0, D, E, M, W, NUM_STAGES };
+    uint64_t cycle = 0;
+    StageSlot stage[NUM_STAGES];
+    uint8_t events = 0;              // CycleEvent 位掩码
+    uint8_t fwd_A = Forward::NONE;   // 本周期执行阶段 valA 的来源
+    uint8_t fwd_B = Forward::NONE;   // 本周期执行阶段 valB 的来源
+};
+
+// 周期级流水线跟踪（预分配的环形缓冲区，只保留最近 capacity 个周期）
+// 由 PipelineSimulator::setCycleTracer 挂接，未挂接时模拟器每周期只多一次空指针判断。
+class CycleTracer {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+    static constexpr size_t MAX_CAPACITY = 16 * 1024 * 1024;
+
+    explicit CycleTracer(size_t capacity = DEFAULT_CAPACITY);
+
+    // 返回下一个周期要填写的记录（缓冲区满时覆盖最旧的记录）
+    CycleRecord& push() {
+        CycleRecord& rec = records_[head_];
+        head_ = (head_ + 1 == records_.size()) ? 0 : head_ + 1;
+        if (size_ < records_.size()) size_++;
+        total_++;
+        return rec;
+    }
+    void clear();
+
+    // 缓冲区中保留的周期数，以及总共记录过的周期数
+    size_t size() const { return size_; }
+    uint64_t total() const { return total_; }
+    // 第 i 个保留的记录（0 为最旧）
+    const CycleRecord& operator[](size_t i) const;
+
+    // 紧凑文本格式：每周期一行
+    void dumpCompact(FILE* out) const;
+    // Chrome trace-event JSON（chrome://tracing 或 Perfetto 打开），每个阶段一条时间线
+    void dumpChromeTrace(FILE* out) const;
+
+private:
+    std::vector<CycleRecord> records_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+    uint64_t total_ = 0;
+};
+
+#endif // CYCLE_TRACE_H
@@ -0,0 +1,57 @@
+#include "decode_cache.h"
+
+DecodeCache::DecodeCache(size_t entries) {
+    // 向上取整到2的幂
+    size_t size = 1;
+    while (size < entries) size <<= 1;
+    entries_.resize(size);
+    mask_ = size - 1;
+}
+
+void DecodeCache::clear() {
+    for (auto& entry : entries_) {
+        entry.tag = INVALID_TAG;
+    }
+    hits_ = 0;
+    misses_ = 0;
+}
+
+void DecodeCache::invalidate(Memory& mem) {
+    for (uint64_t word : mem.getCodeWrites()) {
+        // 被写的字节为 [word, word+8)，起始于 [word-9, word+7] 的指令都可能覆盖它们
+        // 按个数迭代：存储器占满地址空间时 word+8 会回绕到0
+        uint64_t first = (word >= MAX_INST_LEN - 1) ? word - (MAX_INST_LEN - 1) : 0;
+        uint64_t count = word - first + 8;
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t pc = first + i;
+            Entry& entry = entries_[pc & mask_];
+            if (entry.tag == pc) {
+                entry.tag = INVALID_TAG;
+            }
+        }
+    }
+    mem.clearCodeWrites();
+}
+
+const Instruction& DecodeCache::lookup(Memory& mem, uint64_t pc) {
+    if (!mem.getCodeWrites().empty()) {
+        invalidate(mem);
+    }
+    
+    Entry& entry = entries_[pc & mask_];
+    if (entry.tag == pc) {
+        hits_++;
+        return entry.inst;
+    }
+    
+    misses_++;
+    Instruction inst = Y86::decodeInstruction(mem, pc);
+    if (inst.stat != Y86::STAT_AOK) {
+        scratch_ = inst;
+        return scratch_;
+    }
+    mem.markCode(pc, inst.length);
+    entry.tag = pc;
+    entry.inst = inst;
+    return entry.inst;
+}
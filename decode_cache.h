@@ -0,0 +1,43 @@
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include "y86.h"
+#include <cstdint>
+#include <vector>
+
+// 预译码指令缓存（直接映射，按PC索引）
+// 命中时直接返回已译码的 Instruction；译码成功的指令会在 Memory 中标记为代码，
+// 之后写入这些字节（自修改代码）会使覆盖它们的缓存条目失效。
+class DecodeCache {
+public:
+    static constexpr size_t DEFAULT_ENTRIES = 4096;  // 必须是2的幂
+
+    explicit DecodeCache(size_t entries = DEFAULT_ENTRIES);
+
+    // 查找 pc 处的指令，未命中时从内存译码并填入缓存
+    const Instruction& lookup(Memory& mem, uint64_t pc);
+    void clear();
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    static constexpr uint64_t MAX_INST_LEN = 10;  // Y86最长指令字节数
+    static constexpr uint64_t INVALID_TAG = ~0ULL;
+
+    struct Entry {
+        uint64_t tag = INVALID_TAG;  // 缓存的指令PC
+        Instruction inst;
+    };
+
+    // 处理 Memory 记录的代码写入，使受影响的条目失效
+    void invalidate(Memory& mem);
+
+    std::vector<Entry> entries_;
+    uint64_t mask_;
+    Instruction scratch_;  // 译码失败的指令不进缓存，返回这里的副本
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+#endif // DECODE_CACHE_H
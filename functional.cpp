@@ -0,0 +1,192 @@
+#include "functional.h"
+#include <algorithm>
+#include <stdexcept>
+
+FunctionalSimulator::FunctionalSimulator()
+    : PC_(0), STAT_(Y86::STAT_AOK), instruction_count_(0) {
+    // 初始条件码：ZF=1, SF=0, OF=0（根据CSAPP）
+    CC_ = {true, false, false};
+}
+
+void FunctionalSimulator::loadProgram(const std::vector<uint8_t>& program) {
+    ProgramImage image;
+    image.append(0, program.data(), program.size());
+    loadProgram(image);
+}
+
+void FunctionalSimulator::loadProgram(const ProgramImage& image) {
+    mem_.reset();
+    regs_.reset();
+    // 按.yo文件中的绝对地址逐段写入，超出地址空间的部分被截断
+    image.loadInto(mem_);
+    mem_.clearDirty();
+    decode_cache_.clear();
+    PC_ = 0;
+    STAT_ = Y86::STAT_AOK;
+    CC_ = {true, false, false};
+    trace_.clear();
+    instruction_count_ = 0;
+    stop_requested_ = false;
+}
+
+void FunctionalSimulator::recordState(uint64_t pc) {
+    trace_.append(pc, regs_, mem_, CC_, STAT_);
+    mem_.clearDirty();
+    if (sink_) {
+        sink_(trace_.back());
+    }
+}
+
+void FunctionalSimulator::emitInst(uint64_t pc, const Instruction& inst, uint64_t next_pc,
+                                   uint64_t mem_addr, bool taken, uint8_t stat) {
+    RetiredInst retired;
+    retired.pc = pc;
+    retired.valP = pc + inst.length;
+    retired.next_pc = next_pc;
+    retired.valC = inst.valC;
+    retired.mem_addr = mem_addr;
+    retired.icode = inst.icode;
+    retired.ifun = inst.ifun;
+    retired.rA = inst.rA;
+    retired.rB = inst.rB;
+    retired.taken = taken;
+    retired.stat = stat;
+    inst_sink_(retired);
+}
+
+void FunctionalSimulator::memoryError(uint64_t pc, const Instruction& inst) {
+    // 与流水线一致：记录的PC为 valP - 2
+    STAT_ = Y86::STAT_ADR;
+    recordState(pc + inst.length - 2);
+}
+
+void FunctionalSimulator::run() {
+    while (step()) {
+    }
+}
+
+bool FunctionalSimulator::step() {
+    if (STAT_ != Y86::STAT_AOK || stop_requested_) {
+        return false;
+    }
+    if (instruction_count_ >= Y86::MAX_RETIRED) {
+        STAT_ = Y86::STAT_INS;
+        return false;
+    }
+
+    uint64_t pc = PC_;
+    Instruction inst = decode_cache_.lookup(mem_, pc);
+    if (inst.stat == Y86::STAT_INS) {
+        // 流水线在取指阶段直接丢弃非法指令并继续取下一个字节
+        PC_ = pc + inst.length;
+        if (inst_sink_) {
+            emitInst(pc, inst, PC_, 0, false, Y86::STAT_INS);
+        }
+        return true;
+    }
+    if (inst.stat != Y86::STAT_AOK) {
+        STAT_ = inst.stat;
+        return false;
+    }
+
+    uint64_t valP = pc + inst.length;
+    uint64_t next_pc = valP;
+    uint64_t rsp = static_cast<uint64_t>(regs_.get(Y86::RSP));
+    uint64_t mem_addr = 0;
+    bool taken = false;
+
+    try {
+        switch (inst.icode) {
+            case Y86::HALT:
+                STAT_ = Y86::STAT_HLT;
+                instruction_count_++;
+                recordState(pc);
+                if (inst_sink_) {
+                    emitInst(pc, inst, pc, 0, false, Y86::STAT_HLT);
+                }
+                return false;
+
+            case Y86::NOP:
+                break;
+
+            case Y86::RRMOVQ:  // 包括CMOVXX
+                taken = Y86::evalCondition(inst.ifun, CC_);
+                if (taken) {
+                    regs_.set(inst.rB, regs_.get(inst.rA));
+                }
+                break;
+
+            case Y86::IRMOVQ:
+                regs_.set(inst.rB, static_cast<int64_t>(inst.valC));
+                break;
+
+            case Y86::RMMOVQ:
+                mem_addr = static_cast<uint64_t>(regs_.get(inst.rB)) + inst.valC;
+                mem_.write64(mem_addr, static_cast<uint64_t>(regs_.get(inst.rA)));
+                break;
+
+            case Y86::MRMOVQ:
+                mem_addr = static_cast<uint64_t>(regs_.get(inst.rB)) + inst.valC;
+                regs_.set(inst.rA, static_cast<int64_t>(mem_.read64(mem_addr)));
+                break;
+
+            case Y86::OPQ: {
+                int64_t valE = Y86::aluOp(inst.ifun, regs_.get(inst.rA), regs_.get(inst.rB), CC_);
+                regs_.set(inst.rB, valE);
+                break;
+            }
+
+            case Y86::JXX:
+                taken = Y86::evalCondition(inst.ifun, CC_);
+                if (taken) {
+                    next_pc = inst.valC;
+                }
+                break;
+
+            case Y86::CALL:
+                // 即使压栈失败，RSP也已更新（与流水线写回阶段一致）
+                regs_.set(Y86::RSP, static_cast<int64_t>(rsp - 8));
+                mem_addr = rsp - 8;
+                mem_.write64(mem_addr, valP);
+                next_pc = inst.valC;
+                break;
+
+            case Y86::RET: {
+                regs_.set(Y86::RSP, static_cast<int64_t>(rsp + 8));
+                mem_addr = rsp;
+                next_pc = mem_.read64(rsp);
+                break;
+            }
+
+            case Y86::PUSHQ: {
+                int64_t valA = regs_.get(inst.rA);
+                regs_.set(Y86::RSP, static_cast<int64_t>(rsp - 8));
+                mem_addr = rsp - 8;
+                mem_.write64(mem_addr, static_cast<uint64_t>(valA));
+                break;
+            }
+
+            case Y86::POPQ: {
+                regs_.set(Y86::RSP, static_cast<int64_t>(rsp + 8));
+                mem_addr = rsp;
+                // dstM 在 dstE 之后写回，popq %rsp 得到内存中的值
+                regs_.set(inst.rA, static_cast<int64_t>(mem_.read64(rsp)));
+                break;
+            }
+        }
+    } catch (const std::runtime_error&) {
+        memoryError(pc, inst);
+        if (inst_sink_) {
+            emitInst(pc, inst, next_pc, mem_addr, taken, Y86::STAT_ADR);
+        }
+        return false;
+    }
+
+    PC_ = next_pc;
+    instruction_count_++;
+    recordState(next_pc);
+    if (inst_sink_) {
+        emitInst(pc, inst, next_pc, mem_addr, taken, Y86::STAT_AOK);
+    }
+    return true;
+}
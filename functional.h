@@ -0,0 +1,98 @@
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+
+#include "y86.h"
+#include "decode_cache.h"
+#include "trace.h"
+#include "loader.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// 执行完的一条指令（按程序顺序交给时序模型，时序模型本身不保存体系结构状态）
+struct RetiredInst {
+    uint64_t pc = 0;
+    uint64_t valP = 0;       // 顺序执行的下一条PC
+    uint64_t next_pc = 0;    // 实际的下一条PC（跳转、调用和返回的目标）
+    uint64_t valC = 0;
+    uint64_t mem_addr = 0;   // 访存地址（不访存的指令为0）
+    uint8_t icode = Y86::NOP;
+    uint8_t ifun = 0;
+    uint8_t rA = Y86::RNONE;
+    uint8_t rB = Y86::RNONE;
+    bool taken = false;      // JXX 是否跳转 / CMOVXX 条件是否成立
+    // HLT：停机指令；ADR：访存出错的指令（两者都是最后一条）；
+    // INS：取指时被跳过的非法指令（只占用取指）
+    uint8_t stat = Y86::STAT_AOK;
+};
+
+// 功能级（ISA级）模拟器
+// 每一步完整执行一条指令，没有流水线寄存器、转发和冒险检测，
+// 只关心体系结构状态。产生的退休状态序列与 PipelineSimulator 完全一致。
+class FunctionalSimulator {
+public:
+    FunctionalSimulator();
+
+    // 配置内存地址空间（在 loadProgram 之前调用，会清空内存）
+    void setMemoryConfig(const MemoryConfig& config) { mem_.configure(config); }
+
+    // 加载程序到内存
+    void loadProgram(const std::vector<uint8_t>& program);
+    void loadProgram(const ProgramImage& image);
+
+    // 运行到停机或出错
+    void run();
+    // 执行一条指令；返回 false 表示已停机、出错或被请求停止
+    bool step();
+    // 请求停止 run()，语义同 PipelineSimulator
+    void requestStop() { stop_requested_ = true; }
+
+    using State = ArchState;
+    const TraceLog& getTrace() const { return trace_; }
+    std::vector<State> getStates() const {
+        return std::vector<State>(trace_.begin(), trace_.end());
+    }
+
+    // 状态回调和历史保留，语义同 PipelineSimulator
+    using StateSink = std::function<void(const State&)>;
+    void setStateSink(StateSink sink) { sink_ = std::move(sink); }
+    void setRecordTrace(bool record) { trace_.setRetain(record); }
+
+    // 指令回调：每执行完一条指令（包括停机、出错和被跳过的非法指令）按程序顺序调用，
+    // 用于驱动时序模型
+    using InstSink = std::function<void(const RetiredInst&)>;
+    void setInstSink(InstSink sink) { inst_sink_ = std::move(sink); }
+
+    struct PerformanceStats {
+        uint64_t instructions_retired;  // 已完成的指令数
+    };
+    PerformanceStats getPerformanceStats() const {
+        PerformanceStats stats;
+        stats.instructions_retired = instruction_count_;
+        return stats;
+    }
+
+private:
+    // 访存出错：按流水线的约定记录错误状态并停机
+    void memoryError(uint64_t pc, const Instruction& inst);
+    void recordState(uint64_t pc);
+    // 把执行完的指令交给 inst_sink_（只在挂接时调用）
+    void emitInst(uint64_t pc, const Instruction& inst, uint64_t next_pc, uint64_t mem_addr,
+                  bool taken, uint8_t stat);
+
+    uint64_t PC_;
+    RegisterFile regs_;
+    Memory mem_;
+    ConditionCodes CC_;
+    uint8_t STAT_;
+
+    DecodeCache decode_cache_;
+    TraceLog trace_;
+    StateSink sink_;
+    InstSink inst_sink_;
+
+    uint64_t instruction_count_;
+    bool stop_requested_ = false;
+};
+
+#endif // FUNCTIONAL_H
@@ -0,0 +1,206 @@
+#include "loader.h"
+#include "ybo.h"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+void ProgramImage::append(uint64_t addr, const uint8_t* data, size_t len) {
+    if (len == 0) return;
+    if (!segments.empty()) {
+        Segment& last = segments.back();
+        if (last.offset + last.length == bytes.size() && last.addr + last.length == addr) {
+            bytes.insert(bytes.end(), data, data + len);
+            last.length += len;
+            return;
+        }
+    }
+    segments.push_back({addr, bytes.size(), len});
+    bytes.insert(bytes.end(), data, data + len);
+}
+
+void ProgramImage::loadInto(Memory& mem) const {
+    for (const auto& seg : segments) {
+        if (!mem.inBounds(seg.addr, 1)) continue;
+        size_t len = seg.length;
+        if (!mem.inBounds(seg.addr, len)) {
+            len = static_cast<size_t>(mem.lastAddress() - seg.addr + 1);
+        }
+        mem.writeBytes(seg.addr, bytes.data() + seg.offset, len);
+    }
+}
+
+namespace {
+
+// 十六进制字符 -> 值，非十六进制为 -1
+struct HexTable {
+    int8_t val[256];
+    HexTable() {
+        std::memset(val, -1, sizeof(val));
+        for (int i = 0; i < 10; i++) val['0' + i] = static_cast<int8_t>(i);
+        for (int i = 0; i < 6; i++) {
+            val['a' + i] = static_cast<int8_t>(10 + i);
+            val['A' + i] = static_cast<int8_t>(10 + i);
+        }
+    }
+};
+const HexTable HEX;
+
+inline int hexValue(char c) {
+    return HEX.val[static_cast<unsigned char>(c)];
+}
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+void report(std::vector<LoadDiagnostic>* diagnostics, size_t line, const char* message) {
+    if (diagnostics) {
+        diagnostics->push_back({line, message});
+    }
+}
+
+}  // namespace
+
+// 每行的格式：  0x<地址>: <十六进制字节> | <汇编/注释>
+// '|' 左边为空的行和 '#' 开头的行是纯注释
+ProgramImage parseYo(const char* data, size_t len, std::vector<LoadDiagnostic>* diagnostics,
+                     std::vector<SourceLine>* source) {
+    ProgramImage image;
+    image.bytes.reserve(len / 4);
+    uint8_t line_bytes[256];
+
+    const char* p = data;
+    const char* end = data + len;
+    size_t line_no = 0;
+    while (p < end) {
+        line_no++;
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* line_end = eol ? eol : end;
+        const char* next = eol ? eol + 1 : end;
+        if (line_end > p && line_end[-1] == '\r') line_end--;
+
+        const char* s = p;
+        p = next;
+        while (s < line_end && isBlank(*s)) s++;
+        if (s == line_end || *s == '#') continue;
+
+        const char* pipe = static_cast<const char*>(std::memchr(s, '|', line_end - s));
+        if (!pipe) {
+            report(diagnostics, line_no, "missing '|'");
+            continue;
+        }
+        if (s == pipe) continue;  // 只有注释
+
+        // 地址
+        if (pipe - s < 2 || s[0] != '0' || (s[1] != 'x' && s[1] != 'X')) {
+            report(diagnostics, line_no, "expected address '0x...'");
+            continue;
+        }
+        s += 2;
+        uint64_t addr = 0;
+        int digits = 0;
+        while (s < pipe && hexValue(*s) >= 0) {
+            addr = (addr << 4) | static_cast<uint64_t>(hexValue(*s));
+            s++;
+            digits++;
+        }
+        while (s < pipe && isBlank(*s)) s++;
+        if (digits == 0 || digits > 16 || s == pipe || *s != ':') {
+            report(diagnostics, line_no, "bad address");
+            continue;
+        }
+        s++;
+        const uint64_t line_addr = addr;
+
+        // 指令/数据字节（字节之间可以有空白）
+        size_t count = 0;
+        int high = -1;
+        bool bad = false;
+        for (; s < pipe; s++) {
+            if (isBlank(*s)) continue;
+            int v = hexValue(*s);
+            if (v < 0) {
+                bad = true;
+                break;
+            }
+            if (high < 0) {
+                high = v;
+                continue;
+            }
+            line_bytes[count++] = static_cast<uint8_t>((high << 4) | v);
+            high = -1;
+            if (count == sizeof(line_bytes)) {
+                image.append(addr, line_bytes, count);
+                addr += count;
+                count = 0;
+            }
+        }
+        if (bad) {
+            report(diagnostics, line_no, "invalid hex byte");
+        } else if (high >= 0) {
+            report(diagnostics, line_no, "odd number of hex digits");
+        }
+        // 出错之前已经解析出的字节仍然加载（与原来的解析器一致）
+        image.append(addr, line_bytes, count);
+
+        if (source) {
+            const char* text = pipe + 1;
+            const char* text_end = line_end;
+            while (text < text_end && isBlank(*text)) text++;
+            while (text_end > text && isBlank(text_end[-1])) text_end--;
+            source->push_back({line_addr, addr + count != line_addr, std::string(text, text_end)});
+        }
+    }
+    return image;
+}
+
+namespace {
+
+std::vector<uint8_t> readStream(FILE* in) {
+    std::vector<uint8_t> buf(64 * 1024);
+    size_t used = 0;
+    while (true) {
+        used += std::fread(buf.data() + used, 1, buf.size() - used, in);
+        if (used < buf.size()) {
+            if (std::ferror(in)) {
+                throw std::runtime_error("Cannot read input");
+            }
+            break;
+        }
+        buf.resize(buf.size() * 2);
+    }
+    buf.resize(used);
+    return buf;
+}
+
+ProgramImage parseBuffer(std::vector<uint8_t>&& buf, std::vector<LoadDiagnostic>* diagnostics,
+                         std::vector<SourceLine>* source) {
+    if (Ybo::isYbo(buf.data(), buf.size())) {
+        return Ybo::decode(std::move(buf));
+    }
+    return parseYo(reinterpret_cast<const char*>(buf.data()), buf.size(), diagnostics, source);
+}
+
+}  // namespace
+
+ProgramImage loadProgramStream(FILE* in, std::vector<LoadDiagnostic>* diagnostics,
+                               std::vector<SourceLine>* source) {
+    return parseBuffer(readStream(in), diagnostics, source);
+}
+
+ProgramImage loadProgramFile(const std::string& path, std::vector<LoadDiagnostic>* diagnostics,
+                             std::vector<SourceLine>* source) {
+    std::unique_ptr<FILE, int (*)(FILE*)> in(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!in) {
+        throw std::runtime_error("Cannot open input " + path);
+    }
+    // 普通文件按大小一次读入；不可定位的输入（管道等）按流读取
+    if (std::fseek(in.get(), 0, SEEK_END) != 0) {
+        return loadProgramStream(in.get(), diagnostics, source);
+    }
+    long size = std::ftell(in.get());
+    std::rewind(in.get());
+    std::vector<uint8_t> buf(size > 0 ? static_cast<size_t>(size) : 0);
+    buf.resize(std::fread(buf.data(), 1, buf.size(), in.get()));
+    return parseBuffer(std::move(buf), diagnostics, source);
+}
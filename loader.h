@@ -0,0 +1,55 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "y86.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// 程序映像：若干连续字节段（相邻地址的行合并为一段），所有字节存放在同一个缓冲区
+struct ProgramImage {
+    struct Segment {
+        uint64_t addr;
+        size_t offset;  // 在 bytes 中的起始位置
+        size_t length;
+    };
+
+    std::vector<uint8_t> bytes;
+    std::vector<Segment> segments;
+
+    bool empty() const { return segments.empty(); }
+    // 追加一段字节（与上一段首尾相接时直接扩展上一段）
+    void append(uint64_t addr, const uint8_t* data, size_t len);
+    // 写入内存（超出地址空间的部分被截断）
+    void loadInto(Memory& mem) const;
+};
+
+// 格式错误的行（不影响其余行的加载）
+struct LoadDiagnostic {
+    size_t line;  // 从1开始的行号
+    std::string message;
+};
+
+// .yo 中带地址的行 '|' 右边的汇编/注释文本（性能分析时用于标注）
+struct SourceLine {
+    uint64_t addr;
+    bool has_bytes;    // 该行是否包含指令/数据字节（否则是标号或伪指令）
+    std::string text;  // 去掉首尾空白
+};
+
+// 解析已经整体读入内存的.yo文本（兼容CRLF），直接把十六进制解码到映像中，
+// 不为每行/每个字节分配内存。diagnostics 非空时记录格式错误的行，
+// source 非空时按行序保留源文本（默认丢弃）。
+ProgramImage parseYo(const char* data, size_t len, std::vector<LoadDiagnostic>* diagnostics = nullptr,
+                     std::vector<SourceLine>* source = nullptr);
+
+// 一次性读入整个文件/流后解析，根据魔数自动识别 .ybo 二进制格式，否则按 .yo 文本解析
+// （.ybo 不含源文本）。无法读取或 .ybo 格式错误时抛出 std::runtime_error
+ProgramImage loadProgramFile(const std::string& path, std::vector<LoadDiagnostic>* diagnostics = nullptr,
+                             std::vector<SourceLine>* source = nullptr);
+ProgramImage loadProgramStream(FILE* in, std::vector<LoadDiagnostic>* diagnostics = nullptr,
+                               std::vector<SourceLine>* source = nullptr);
+
+#endif // LOADER_H
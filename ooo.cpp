@@ -0,0 +1,241 @@
+#include "ooo.h"
+#include "timing.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+bool isLoad(uint8_t icode) {
+    return icode == Y86::MRMOVQ || icode == Y86::POPQ || icode == Y86::RET;
+}
+
+bool isStore(uint8_t icode) {
+    return icode == Y86::RMMOVQ || icode == Y86::PUSHQ || icode == Y86::CALL;
+}
+
+// 从 [front, ...) 中释放早于 cycle 的项，已满时等到最早的一项释放后的下一个周期
+uint64_t waitForEntry(std::deque<uint64_t>& entries, size_t size, uint64_t cycle) {
+    while (!entries.empty() && entries.front() < cycle) entries.pop_front();
+    if (entries.size() >= size) {
+        cycle = entries.front() + 1;
+        entries.pop_front();
+    }
+    return cycle;
+}
+
+}  // namespace
+
+const char* OutOfOrderModel::structureName(Structure structure) {
+    switch (structure) {
+        case ROB: return "rob_full";
+        case RS: return "rs_full";
+        default: return "lsq_full";
+    }
+}
+
+OutOfOrderModel::OutOfOrderModel(const Config& config)
+    : config_(config), ras_(config.ras_depth) {
+    if (config_.width == 0 || config_.rob_size == 0 || config_.rs_size == 0 ||
+        config_.lsq_size == 0 || config_.mem_units == 0 ||
+        config_.alu_latency == 0 || config_.mem_latency == 0) {
+        throw std::runtime_error("out-of-order model sizes and latencies must be at least 1");
+    }
+    predictor_ = makeBranchPredictor(config_.predictor);
+    if (!predictor_) {
+        throw std::runtime_error("unknown branch predictor " + config_.predictor);
+    }
+    reset();
+}
+
+void OutOfOrderModel::reset() {
+    predictor_->reset();
+    ras_.reset();
+    pending_updates_.clear();
+    fetch_slots_.assign(config_.width, 0);
+    decode_slots_.assign(config_.width, 0);
+    dispatch_slots_.assign(config_.width, 0);
+    commit_slots_.assign(config_.width, 0);
+    seq_ = 0;
+    last_fetch_ = 0;
+    last_dispatch_ = 0;
+    last_commit_ = 0;
+    fetch_break_ = false;
+    fetch_ready_ = 1;
+    rob_.clear();
+    lsq_.clear();
+    rs_ = {};
+    for (auto& busy : unit_busy_) busy.clear();
+    cdb_busy_.clear();
+    std::fill(std::begin(reg_ready_), std::end(reg_ready_), 0);
+    cc_ready_ = 0;
+    store_address_ready_ = 0;
+    last_store_.clear();
+    stats_ = Stats();
+}
+
+uint64_t OutOfOrderModel::reserve(std::map<uint64_t, unsigned>& table, uint64_t cycle, unsigned limit) {
+    auto it = table.lower_bound(cycle);
+    while (it != table.end() && it->first == cycle && it->second >= limit) {
+        ++it;
+        cycle++;
+    }
+    if (it != table.end() && it->first == cycle) {
+        it->second++;
+    } else {
+        table.emplace_hint(it, cycle, 1);
+    }
+    return cycle;
+}
+
+void OutOfOrderModel::prune(uint64_t cycle) {
+    for (auto& busy : unit_busy_) {
+        busy.erase(busy.begin(), busy.lower_bound(cycle));
+    }
+    cdb_busy_.erase(cdb_busy_.begin(), cdb_busy_.lower_bound(cycle));
+    if (last_store_.size() > 4096) {
+        for (auto it = last_store_.begin(); it != last_store_.end();) {
+            it = (it->second.commit < cycle) ? last_store_.erase(it) : std::next(it);
+        }
+    }
+}
+
+void OutOfOrderModel::issue(const RetiredInst& inst) {
+    const unsigned width = config_.width;
+    const size_t slot = seq_++ % width;
+
+    // 取指：按顺序、每周期最多 width 条，width 条之前的指令进入译码后才有空位
+    uint64_t fetch = std::max({fetch_ready_, last_fetch_ + (fetch_break_ ? 1 : 0),
+                               fetch_slots_[slot] + 1, decode_slots_[slot]});
+    last_fetch_ = fetch;
+    fetch_slots_[slot] = fetch;
+    fetch_break_ = false;
+
+    // 取指时被丢弃的非法指令不进入后端
+    if (inst.stat == Y86::STAT_INS) {
+        decode_slots_[slot] = fetch + 1;
+        dispatch_slots_[slot] = 0;
+        commit_slots_[slot] = 0;
+        return;
+    }
+
+    // 译码、重命名和分派：等待 ROB、LSQ 和保留站的空闲项
+    uint64_t decode = std::max(fetch + 1, dispatch_slots_[slot] + 1);
+    decode_slots_[slot] = decode;
+    bool load = isLoad(inst.icode);
+    bool store = isStore(inst.icode);
+    bool memory = load || store;
+    bool executes = (inst.icode != Y86::NOP && inst.icode != Y86::HALT);
+
+    uint64_t dispatch = std::max(decode, last_dispatch_);
+    uint64_t waited = waitForEntry(rob_, config_.rob_size, dispatch);
+    stats_.dispatch_stalls[ROB] += waited - dispatch;
+    dispatch = waited;
+    if (memory) {
+        waited = waitForEntry(lsq_, config_.lsq_size, dispatch);
+        stats_.dispatch_stalls[LSQ] += waited - dispatch;
+        dispatch = waited;
+    }
+    if (executes) {
+        while (!rs_.empty() && rs_.top() < dispatch) rs_.pop();
+        if (rs_.size() >= config_.rs_size) {
+            waited = rs_.top() + 1;
+            rs_.pop();
+            while (!rs_.empty() && rs_.top() < waited) rs_.pop();
+            stats_.dispatch_stalls[RS] += waited - dispatch;
+            dispatch = waited;
+        }
+    }
+    last_dispatch_ = dispatch;
+    dispatch_slots_[slot] = dispatch;
+    stats_.rob_occupancy += rob_.size();
+    prune(dispatch);
+
+    // 发射：操作数经 CDB 广播后可用，加载还要等所有更老的存储确定地址
+    RegUse use = regUse(inst.icode, inst.ifun, inst.rA, inst.rB);
+    uint64_t ready = dispatch + 1;
+    for (uint8_t src : {use.srcA, use.srcB}) {
+        if (src != Y86::RNONE) ready = std::max(ready, reg_ready_[src]);
+    }
+    if (use.reads_cc) ready = std::max(ready, cc_ready_);
+    if (load) ready = std::max(ready, store_address_ready_);
+
+    uint64_t start = ready;
+    uint64_t done = ready;     // 最后一个执行周期
+    uint64_t address = ready;  // 访存指令计算出地址（和栈指针）的周期
+    if (memory) {
+        start = reserve(unit_busy_[MEM_UNIT], ready, config_.mem_units);
+        address = start;
+        done = start;
+        if (load) {
+            stats_.loads++;
+            done = start + config_.mem_latency;
+            auto it = last_store_.find(inst.mem_addr);
+            if (it != last_store_.end() && it->second.commit > start) {
+                stats_.store_forwards++;
+                done = std::max(done, it->second.data_ready);
+            }
+        } else {
+            stats_.stores++;
+            store_address_ready_ = std::max(store_address_ready_, start + 1);
+        }
+    } else if (executes) {
+        start = reserve(unit_busy_[ALU_UNIT], ready, width);
+        unsigned latency = (inst.icode == Y86::OPQ) ? config_.alu_latency : 1;
+        done = start + latency - 1;
+    }
+    if (executes) rs_.push(start);
+
+    // 写回：结果占用 CDB 广播，之后相关指令才能发射
+    uint64_t complete = done + 1;
+    if (use.dstE != Y86::RNONE) {
+        uint64_t broadcast = reserve(cdb_busy_, (memory ? address : done) + 1, width);
+        reg_ready_[use.dstE] = broadcast;
+        if (use.writes_cc) cc_ready_ = broadcast;
+        complete = std::max(complete, broadcast);
+    }
+    if (use.dstM != Y86::RNONE) {
+        uint64_t broadcast = reserve(cdb_busy_, done + 1, width);
+        reg_ready_[use.dstM] = broadcast;
+        complete = std::max(complete, broadcast);
+    }
+
+    // 按顺序提交，每周期最多 width 条
+    uint64_t commit = std::max({complete + 1, last_commit_, commit_slots_[slot] + 1});
+    last_commit_ = commit;
+    commit_slots_[slot] = commit;
+    rob_.push_back(commit);
+    if (memory) lsq_.push_back(commit);
+    if (store) last_store_[inst.mem_addr] = {start + 1, commit};
+
+    // 控制流：与 PipelineModel 相同的预测器和 RAS，JXX 在执行时确定方向
+    if (inst.icode == Y86::JXX) {
+        auto end = pending_updates_.upper_bound(fetch);
+        for (auto it = pending_updates_.begin(); it != end; ++it) {
+            predictor_->update(it->second.pc, it->second.target, it->second.taken);
+        }
+        pending_updates_.erase(pending_updates_.begin(), end);
+        bool predicted = predictor_->predict(inst.pc, inst.valC, inst.ifun == Y86::C_YES);
+        pending_updates_.insert({start, {inst.pc, inst.valC, inst.taken}});
+        stats_.branches++;
+        fetch_break_ = predicted;
+        if (predicted != inst.taken) {
+            stats_.branch_mispredicts++;
+            fetch_ready_ = std::max(fetch_ready_, done + 1);
+        }
+    } else if (inst.icode == Y86::CALL) {
+        ras_.push(inst.valP);
+        fetch_break_ = true;
+    } else if (inst.icode == Y86::RET) {
+        uint64_t target = 0;
+        fetch_break_ = true;
+        if (ras_.pop(target) && target == inst.next_pc) {
+            stats_.ras_hits++;
+        } else {
+            if (ras_.enabled()) stats_.ras_misses++;
+            fetch_ready_ = std::max(fetch_ready_, done + 1);
+        }
+    }
+
+    stats_.instructions++;
+    stats_.cycles = commit;
+}
@@ -0,0 +1,130 @@
+#ifndef OOO_H
+#define OOO_H
+
+#include "functional.h"
+#include "branch_predictor.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Tomasulo 式乱序执行核心的时序模型
+//
+// 与 PipelineModel 一样由功能级模拟器按程序顺序驱动，只计算每条指令经过各阶段的周期，
+// 退休状态序列与其他引擎完全相同。指令依次经过：
+//   F  取指（每周期 width 条，被预测跳转的控制转移指令结束取指组）
+//   D  译码、寄存器重命名并分派：需要空闲的 ROB 项、保留站项，访存指令还需要 LSQ 项
+//   E  操作数都就绪且有空闲的功能部件时从保留站发射（较老的指令优先），
+//      结果经公共数据总线（CDB，每周期 width 个结果）广播后唤醒相关指令
+//   C  按程序顺序提交（每周期 width 条），同时释放 ROB 和 LSQ 项
+// 重命名把寄存器和条件码映射到最近一条写它的指令，因此只有真相关（RAW）。
+// 加载在所有更老的存储地址确定之后才能执行；地址相同时直接从 LSQ 取存储的数据。
+// 与五级流水线的约定一致：单条指令需要5个周期，加载结果在执行后第2个周期可用，
+// JXX 预测失败时在执行后的下一个周期取到正确的指令，RET 在加载出返回地址之后。
+class OutOfOrderModel {
+public:
+    struct Config {
+        unsigned width = 2;           // 取指/分派/提交宽度、ALU 个数和 CDB 宽度
+        size_t rob_size = 32;
+        size_t rs_size = 16;          // 保留站总项数
+        size_t lsq_size = 16;
+        unsigned mem_units = 1;       // 访存部件（数据端口）个数
+        unsigned alu_latency = 1;     // OPQ 的执行周期数
+        unsigned mem_latency = 1;     // 访问数据存储器的周期数
+        std::string predictor = "nt";
+        size_t ras_depth = 0;
+    };
+
+    // 分派被阻塞的原因
+    enum Structure : uint8_t { ROB, RS, LSQ, NUM_STRUCTURES };
+    static const char* structureName(Structure structure);
+
+    struct Stats {
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        uint64_t branches = 0;
+        uint64_t branch_mispredicts = 0;
+        uint64_t ras_hits = 0;
+        uint64_t ras_misses = 0;
+        uint64_t loads = 0;
+        uint64_t stores = 0;
+        uint64_t store_forwards = 0;                    // 从 LSQ 中更老的存储得到数据的加载
+        uint64_t dispatch_stalls[NUM_STRUCTURES] = {};  // 因结构已满而推迟分派的周期数
+        uint64_t rob_occupancy = 0;                     // 各指令分派时 ROB 中已有的项数之和
+        double cpi() const {
+            return instructions ? static_cast<double>(cycles) / instructions : 0.0;
+        }
+        double ipc() const {
+            return cycles ? static_cast<double>(instructions) / cycles : 0.0;
+        }
+    };
+
+    explicit OutOfOrderModel(const Config& config);
+
+    void reset();
+    // 按程序顺序送入一条执行完的指令
+    void issue(const RetiredInst& inst);
+    const Stats& stats() const { return stats_; }
+    const Config& config() const { return config_; }
+
+private:
+    // 功能部件类别
+    enum Unit : uint8_t { ALU_UNIT, MEM_UNIT, NUM_UNITS };
+
+    struct PendingUpdate {
+        uint64_t pc;
+        uint64_t target;
+        bool taken;
+    };
+    struct StoreEntry {
+        uint64_t data_ready;  // 存储的数据可以转发给加载的周期
+        uint64_t commit;      // 写入存储器（从 LSQ 中释放）的周期
+    };
+
+    // 在 table 中从 cycle 开始找到第一个使用数少于 limit 的周期并占用
+    static uint64_t reserve(std::map<uint64_t, unsigned>& table, uint64_t cycle, unsigned limit);
+    // 丢弃早于 cycle 的占用记录（之后分派的指令不会早于该周期发射）
+    void prune(uint64_t cycle);
+
+    Config config_;
+    std::unique_ptr<BranchPredictor> predictor_;
+    ReturnAddressStack ras_;
+    // 在执行阶段确定方向的 JXX 按确定的周期排序，取指时应用已经确定的更新
+    std::multimap<uint64_t, PendingUpdate> pending_updates_;
+
+    // 最近 width 条指令的取指、进入译码和分派周期（按指令序号轮流使用）
+    std::vector<uint64_t> fetch_slots_;
+    std::vector<uint64_t> decode_slots_;
+    std::vector<uint64_t> dispatch_slots_;
+    std::vector<uint64_t> commit_slots_;
+    uint64_t seq_ = 0;
+    uint64_t last_fetch_ = 0;
+    uint64_t last_dispatch_ = 0;
+    uint64_t last_commit_ = 0;
+    bool fetch_break_ = false;
+    uint64_t fetch_ready_ = 1;
+
+    // 占用中的结构：ROB 和 LSQ 按程序顺序释放（提交周期），保留站在发射时释放
+    std::deque<uint64_t> rob_;
+    std::deque<uint64_t> lsq_;
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> rs_;
+
+    // 各周期已占用的功能部件和 CDB
+    std::map<uint64_t, unsigned> unit_busy_[NUM_UNITS];
+    std::map<uint64_t, unsigned> cdb_busy_;
+
+    // 重命名后各寄存器和条件码的值可以被发射的指令使用的周期
+    uint64_t reg_ready_[16] = {};
+    uint64_t cc_ready_ = 0;
+    // 所有更老的存储确定地址的周期，以及各地址最近一次存储
+    uint64_t store_address_ready_ = 0;
+    std::unordered_map<uint64_t, StoreEntry> last_store_;
+
+    Stats stats_;
+};
+
+#endif // OOO_H
@@ -0,0 +1,193 @@
+#include "output.h"
+#include <charconv>
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+JsonTraceWriter::JsonTraceWriter(FILE* out) : out_(out) {
+    buf_.reserve(BUFFER_SIZE + 4096);
+}
+
+JsonTraceWriter::~JsonTraceWriter() {
+    flush();
+}
+
+void JsonTraceWriter::put(const char* s, size_t len) {
+    buf_.append(s, len);
+    if (buf_.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+void JsonTraceWriter::put(const char* s) {
+    put(s, std::strlen(s));
+}
+
+void JsonTraceWriter::putInt(int64_t val) {
+    char tmp[24];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), val);
+    put(tmp, res.ptr - tmp);
+}
+
+void JsonTraceWriter::putUInt(uint64_t val) {
+    char tmp[24];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), val);
+    put(tmp, res.ptr - tmp);
+}
+
+void JsonTraceWriter::flush() {
+    if (!buf_.empty()) {
+        std::fwrite(buf_.data(), 1, buf_.size(), out_);
+        buf_.clear();
+    }
+    std::fflush(out_);
+}
+
+// 输出格式与原来的 outputJSON 保持一致
+void JsonTraceWriter::write(const ArchState& state) {
+    put(count_ == 0 ? "[\n" : ",\n");
+    count_++;
+
+    put("    {\n");
+
+    // PC
+    put("        \"PC\": ");
+    putUInt(state.PC);
+    put(",\n");
+
+    // REG
+    put("        \"REG\": {\n");
+    for (int i = 0; i < 15; i++) {
+        if (i > 0) put(",\n");
+        put("            \"");
+        put(Y86::getRegName(i).c_str());
+        put("\": ");
+        putInt(state.regs.get(i));
+    }
+    put("\n        },\n");
+
+    // MEM
+    put("        \"MEM\": {\n");
+    bool first_mem = true;
+    for (const auto& pair : state.mem_snapshot) {
+        if (!first_mem) put(",\n");
+        put("            \"");
+        putUInt(pair.first);
+        put("\": ");
+        putInt(pair.second);
+        first_mem = false;
+    }
+    put("\n        },\n");
+
+    // CC
+    put("        \"CC\": {\n");
+    put(state.CC.ZF ? "            \"ZF\": 1,\n" : "            \"ZF\": 0,\n");
+    put(state.CC.SF ? "            \"SF\": 1,\n" : "            \"SF\": 0,\n");
+    put(state.CC.OF ? "            \"OF\": 1\n" : "            \"OF\": 0\n");
+    put("        },\n");
+
+    // STAT
+    put("        \"STAT\": ");
+    putUInt(state.STAT);
+    put("\n    }");
+}
+
+void JsonTraceWriter::finish() {
+    if (finished_) return;
+    finished_ = true;
+    put(count_ == 0 ? "[\n\n]\n" : "\n]\n");
+    flush();
+}
+
+// 周期分解：退休周期之外的每个周期按流水线在写回阶段实际看到的空位来源计入一类
+// （SlotCause），各项之和等于总周期数
+void writeStatsJson(FILE* out, const PipelineSimulator::PerformanceStats& stats,
+                    const std::string& predictor) {
+    const auto& d = stats.detail;
+    auto u = [](uint64_t v) { return static_cast<unsigned long long>(v); };
+    uint64_t accounted = stats.instructions_retired;
+    for (uint64_t cycles : d.lost_cycles) accounted += cycles;
+    if (accounted != stats.total_cycles) {
+        throw std::runtime_error("cycle breakdown sums to " + std::to_string(accounted) +
+                                 " cycles but total_cycles is " + std::to_string(stats.total_cycles));
+    }
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "    \"total_cycles\": %llu,\n", u(stats.total_cycles));
+    std::fprintf(out, "    \"instructions_retired\": %llu,\n", u(stats.instructions_retired));
+    std::fprintf(out, "    \"ipc\": %.6f,\n", stats.ipc);
+    std::fprintf(out, "    \"stall_cycles\": %llu,\n", u(stats.stall_cycles));
+    std::fprintf(out, "    \"bubble_cycles\": %llu,\n", u(stats.bubble_cycles));
+    std::fprintf(out, "    \"load_use_bypasses\": %llu,\n", u(stats.load_use_bypasses));
+    std::fprintf(out, "    \"ret_flushes\": %llu,\n", u(d.ret_flushes));
+    std::fprintf(out, "    \"control_bubbles\": %llu,\n", u(d.control_bubbles));
+    std::fprintf(out, "    \"fill_cycles\": %llu,\n", u(d.fill_cycles));
+    std::fprintf(out, "    \"drain_cycles\": %llu,\n", u(d.drain_cycles));
+
+    std::fprintf(out, "    \"cycle_breakdown\": {\"retire\": %llu", u(stats.instructions_retired));
+    for (int i = 0; i < SlotCause::NUM_CAUSES; i++) {
+        std::fprintf(out, ", \"%s\": %llu", SlotCause::name(static_cast<SlotCause::Cause>(i)),
+                     u(d.lost_cycles[i]));
+    }
+    std::fprintf(out, "},\n");
+
+    std::fprintf(out, "    \"retired_by_icode\": {");
+    bool first = true;
+    for (int i = 0; i < 16; i++) {
+        if (d.retired_by_icode[i] == 0) continue;
+        std::fprintf(out, "%s\"%s\": %llu", first ? "" : ", ", Y86::getIcodeName(i),
+                     u(d.retired_by_icode[i]));
+        first = false;
+    }
+    std::fprintf(out, "},\n");
+
+    std::fprintf(out, "    \"load_use_stalls_by_reg\": {");
+    first = true;
+    for (int i = 0; i < 15; i++) {
+        if (d.load_use_stalls_by_reg[i] == 0) continue;
+        std::fprintf(out, "%s\"%s\": %llu", first ? "" : ", ", Y86::getRegName(i).c_str(),
+                     u(d.load_use_stalls_by_reg[i]));
+        first = false;
+    }
+    std::fprintf(out, "},\n");
+
+    std::fprintf(out, "    \"forwarding\": {");
+    for (int i = Forward::REGFILE; i < Forward::NUM_SOURCES; i++) {
+        std::fprintf(out, "%s\"%s\": %llu", i == Forward::REGFILE ? "" : ", ",
+                     Forward::name(static_cast<Forward::Source>(i)), u(d.forward_sources[i]));
+    }
+    std::fprintf(out, "},\n");
+
+    std::fprintf(out, "    \"ras\": {\"hits\": %llu, \"misses\": %llu},\n",
+                 u(stats.ras_hits), u(stats.ras_misses));
+
+    // 只输出启用了的缓存
+    auto cache = [&](const char* name, const Cache::Stats& c, uint64_t stall_cycles) {
+        std::fprintf(out, "    \"%s\": {\"reads\": %llu, \"read_misses\": %llu, \"writes\": %llu, "
+                     "\"write_misses\": %llu, \"miss_rate\": %.6f, \"writebacks\": %llu, "
+                     "\"write_throughs\": %llu, \"stall_cycles\": %llu},\n",
+                     name, u(c.reads), u(c.read_misses), u(c.writes), u(c.write_misses), c.missRate(),
+                     u(c.writebacks), u(c.write_throughs), u(stall_cycles));
+    };
+    if (stats.has_icache) cache("icache", stats.icache, stats.icache_stall_cycles);
+    if (stats.has_dcache) cache("dcache", stats.dcache, stats.dcache_stall_cycles);
+
+    // 分支按PC排序输出
+    std::vector<std::pair<uint64_t, PipelineSimulator::BranchSite>> sites(
+        d.branch_sites.begin(), d.branch_sites.end());
+    std::sort(sites.begin(), sites.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::fprintf(out, "    \"branches\": {\"predictor\": \"%s\", \"executed\": %llu, "
+                 "\"mispredicts\": %llu, \"sites\": [",
+                 predictor.c_str(), u(stats.branches), u(stats.branch_mispredicts));
+    for (size_t i = 0; i < sites.size(); i++) {
+        std::fprintf(out, "%s\n        {\"pc\": %llu, \"executed\": %llu, \"mispredicts\": %llu}",
+                     i == 0 ? "" : ",", u(sites[i].first), u(sites[i].second.executed),
+                     u(sites[i].second.mispredicts));
+    }
+    std::fprintf(out, "%s]}\n", sites.empty() ? "" : "\n    ");
+    std::fprintf(out, "}\n");
+}
@@ -0,0 +1,42 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "trace.h"
+#include "pipeline.h"
+#include <cstdio>
+#include <string>
+
+// 带缓冲的JSON状态输出
+// 每个退休状态立即序列化到内部缓冲区，缓冲区满时写出，
+// 因此模拟还在进行时下游就能读到输出，内存占用也与指令数无关。
+class JsonTraceWriter {
+public:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    explicit JsonTraceWriter(FILE* out);
+    ~JsonTraceWriter();
+
+    // 写入一个状态（自动处理数组开头和逗号分隔）
+    void write(const ArchState& state);
+    // 写入数组结尾并刷新缓冲区
+    void finish();
+    void flush();
+
+private:
+    void put(const char* s, size_t len);
+    void put(const char* s);
+    void putInt(int64_t val);
+    void putUInt(uint64_t val);
+
+    FILE* out_;
+    std::string buf_;
+    size_t count_ = 0;
+    bool finished_ = false;
+};
+
+// 以JSON导出流水线的性能统计和详细计数器（--stats-json）；
+// 周期分解各项之和与总周期数不一致时抛出 std::runtime_error
+void writeStatsJson(FILE* out, const PipelineSimulator::PerformanceStats& stats,
+                    const std::string& predictor);
+
+#endif // OUTPUT_H
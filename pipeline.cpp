@@ -5,98 +5,63 @@
 
 PipelineSimulator::PipelineSimulator() 
     : PC_(0), STAT_(Y86::STAT_AOK), cycle_count_(0), instruction_count_(0), 
-      stall_cycles_(0), bubble_cycles_(0), halted_(false) {
+      stall_cycles_(0), bubble_cycles_(0), branch_count_(0), mispredict_count_(0),
+      ras_hits_(0), ras_misses_(0), load_use_bypasses_(0), halted_(false) {
+    predictor_.reset(new NotTakenPredictor());
     // 初始条件码：ZF=1, SF=0, OF=0（根据CSAPP）
     CC_ = {true, false, false};
 }
 
 void PipelineSimulator::loadProgram(const std::vector<uint8_t>& program) {
+    ProgramImage image;
+    image.append(0, program.data(), program.size());
+    loadProgram(image);
+}
+
+void PipelineSimulator::loadProgram(const ProgramImage& image) {
     mem_.reset();
     regs_.reset();
-    // program vector已经按照.yo文件中的绝对地址加载
-    // 直接使用program的大小来确定内存范围
-    for (size_t i = 0; i < program.size() && i < Memory::MEM_SIZE; i++) {
-        mem_.mem[i] = program[i];
-    }
+    // 按.yo文件中的绝对地址逐段写入，超出地址空间的部分被截断
+    image.loadInto(mem_);
+    mem_.clearDirty();
+    decode_cache_.clear();
     PC_ = 0;
     STAT_ = Y86::STAT_AOK;
     // 初始条件码：ZF=1, SF=0, OF=0（根据CSAPP Y86-64规范）
     CC_ = {true, false, false};
-    states_.clear();
+    trace_.clear();
     cycle_count_ = 0;
     instruction_count_ = 0;
     stall_cycles_ = 0;
     bubble_cycles_ = 0;
+    branch_count_ = 0;
+    mispredict_count_ = 0;
+    predictor_->reset();
+    ras_.reset();
+    ras_committed_.reset();
+    ras_hits_ = 0;
+    ras_misses_ = 0;
+    load_use_bypasses_ = 0;
+    detail_ = DetailedCounters();
+    icache_stall_cycles_ = 0;
+    dcache_stall_cycles_ = 0;
+    if (icache_) icache_->reset();
+    if (dcache_) dcache_->reset();
+    fetch_accessed_ = false;
+    fetch_wait_ = 0;
+    memory_accessed_ = false;
+    memory_wait_ = 0;
     halted_ = false;
+    stop_requested_ = false;
     
     // 初始化流水线寄存器
-    f_d_.valid = false;
-    d_e_.valid = false;
-    e_m_.valid = false;
-    m_w_.valid = false;
+    latches_[0] = PipelineLatches();
+    latches_[1] = PipelineLatches();
+    cur_ = 0;
 }
 
 Instruction PipelineSimulator::parseInstruction(uint64_t pc) const {
-    Instruction inst;
-    inst.stat = Y86::STAT_AOK;
-    
-    if (pc >= Memory::MEM_SIZE) {
-        inst.stat = Y86::STAT_ADR;
-        return inst;
-    }
-    
-    uint8_t byte1 = mem_.mem[pc];
-    inst.icode = (byte1 >> 4) & 0xF;
-    inst.ifun = byte1 & 0xF;
-    inst.length = 1;
-    
-    // 检查非法指令（包括0xFF等）
-    if (inst.icode > 0xB || inst.icode == 0xF) {
-        inst.stat = Y86::STAT_INS;
-        return inst;
-    }
-    
-    // 需要寄存器ID的指令
-    if (needRegids(inst.icode)) {
-        if (pc + 1 >= Memory::MEM_SIZE) {
-            inst.stat = Y86::STAT_ADR;
-            return inst;
-        }
-        uint8_t byte2 = mem_.mem[pc + 1];
-        inst.rA = (byte2 >> 4) & 0xF;
-        inst.rB = byte2 & 0xF;
-        inst.length = 2;
-    } else {
-        inst.rA = Y86::RNONE;
-        inst.rB = Y86::RNONE;
-    }
-    
-    // 需要立即数的指令
-    if (needValC(inst.icode)) {
-        if (pc + inst.length + 8 > Memory::MEM_SIZE) {
-            inst.stat = Y86::STAT_ADR;
-            return inst;
-        }
-        inst.valC = mem_.read64(pc + inst.length);
-        inst.length += 8;
-    } else {
-        inst.valC = 0;
-    }
-    
-    return inst;
-}
-
-bool PipelineSimulator::needRegids(uint8_t icode) const {
-    return icode == Y86::RRMOVQ || icode == Y86::IRMOVQ || 
-           icode == Y86::RMMOVQ || icode == Y86::MRMOVQ ||
-           icode == Y86::OPQ || icode == Y86::PUSHQ || 
-           icode == Y86::POPQ || icode == Y86::CMOVXX;
-}
-
-bool PipelineSimulator::needValC(uint8_t icode) const {
-    return icode == Y86::IRMOVQ || icode == Y86::RMMOVQ || 
-           icode == Y86::MRMOVQ || icode == Y86::JXX || 
-           icode == Y86::CALL;
+    return Y86::decodeInstruction(mem_, pc);
 }
 
 uint64_t PipelineSimulator::getPCNext(uint64_t pc, const Instruction& inst) const {
@@ -108,10 +73,12 @@ void PipelineSimulator::fetch(F_D_Register& f_d) {
     if (STAT_ != Y86::STAT_AOK) {
         f_d.valid = false;
         f_d.stat = STAT_;
+        f_d.cause = SlotCause::OTHER;
         return;
     }
     
-    Instruction inst = parseInstruction(PC_);
+    // 从预译码缓存取指（写入代码区时缓存会自动失效）
+    const Instruction& inst = decode_cache_.lookup(mem_, PC_);
     
     f_d.icode = inst.icode;
     f_d.ifun = inst.ifun;
@@ -119,23 +86,38 @@ void PipelineSimulator::fetch(F_D_Register& f_d) {
     f_d.rB = inst.rB;
     f_d.valC = inst.valC;
     f_d.valP = getPCNext(PC_, inst);
-    f_d.need_regids = needRegids(inst.icode);
-    f_d.need_valC = needValC(inst.icode);
+    f_d.pc = PC_;
+    f_d.pred_taken = false;
+    f_d.ras_predicted = false;
+    f_d.pred_pc = 0;
+    f_d.need_regids = inst.need_regids;
+    f_d.need_valC = inst.need_valC;
     f_d.stat = inst.stat;
     f_d.valid = (inst.stat == Y86::STAT_AOK);
+    f_d.cause = SlotCause::OTHER;  // 只在取指出错（无效）时有意义
     
     // 更新PC（预测下一条指令地址）
-    // 对于JXX，预测不跳转（使用valP），如果预测失败会在execute阶段修正
+    // 对于JXX，由分支预测器决定取valC还是valP，如果预测失败会在execute阶段修正
     // 对于CALL，总是跳转（使用valC）
     // 对于RET，预测下一条PC（但实际PC会在writeBack阶段后更新）
     // 对于HALT，PC不再更新（因为程序即将结束）
     if (inst.icode == Y86::CALL) {
+        ras_.push(f_d.valP);  // 返回地址压入RAS
         PC_ = inst.valC;  // CALL总是跳转
     } else if (inst.icode == Y86::JXX) {
-        PC_ = f_d.valP;   // JXX预测不跳转
+        // 预测器只在译码成功时参与
+        f_d.pred_taken = f_d.valid &&
+            predictor_->predict(PC_, inst.valC, inst.ifun == Y86::C_YES);
+        PC_ = f_d.pred_taken ? inst.valC : f_d.valP;
     } else if (inst.icode == Y86::RET) {
-        // RET指令：PC不在这里更新，会在M阶段后更新
-        // 保持PC不变，等待M阶段后更新
+        // RAS能给出预测时，直接从预测的返回地址继续取指，在M阶段验证
+        // 否则PC不在这里更新，保持PC不变，等待M阶段后更新
+        uint64_t target = 0;
+        if (f_d.valid && ras_.pop(target)) {
+            f_d.ras_predicted = true;
+            f_d.pred_pc = target;
+            PC_ = target;
+        }
     } else if (inst.icode == Y86::HALT) {
         // HALT指令：PC不再更新，停止取指
         // 不修改PC，后续周期不会再fetch新指令
@@ -150,6 +132,10 @@ void PipelineSimulator::decode(const F_D_Register& f_d, D_E_Register& d_e) {
     d_e.ifun = f_d.ifun;
     d_e.valC = f_d.valC;
     d_e.valP = f_d.valP;  // 保存下一条PC
+    d_e.pc = f_d.pc;
+    d_e.pred_taken = f_d.pred_taken;
+    d_e.ras_predicted = f_d.ras_predicted;
+    d_e.pred_pc = f_d.pred_pc;
     d_e.stat = f_d.stat;
     d_e.valid = f_d.valid;
     d_e.is_bubble = false;  // 正常指令不是bubble
@@ -212,63 +198,35 @@ void PipelineSimulator::decode(const F_D_Register& f_d, D_E_Register& d_e) {
     }
 }
 
-// Execute 阶段
-void PipelineSimulator::execute(const D_E_Register& d_e, E_M_Register& e_m) {
+// Execute 阶段（ops 为转发之后的操作数）
+void PipelineSimulator::execute(const D_E_Register& d_e, const ExecuteOperands& ops, E_M_Register& e_m) {
     e_m.icode = d_e.icode;
     e_m.dstE = d_e.dstE;
     e_m.dstM = d_e.dstM;
-    e_m.valA = d_e.valA;
+    e_m.valA = ops.valA;
     e_m.valC = d_e.valC;  // 保存跳转目标地址
     e_m.valP = d_e.valP;  // 保存下一条PC
+    e_m.pc = d_e.pc;
+    e_m.pred_taken = d_e.pred_taken;
+    e_m.ras_predicted = d_e.ras_predicted;
+    e_m.pred_pc = d_e.pred_pc;
     e_m.stat = d_e.stat;
     e_m.valid = d_e.valid;
     e_m.is_bubble = d_e.is_bubble;  // 传递bubble标志
+    e_m.cause = d_e.cause;
+    e_m.valE = 0;
+    e_m.Cnd = false;
     
     uint8_t icode = d_e.icode;
     uint8_t ifun = d_e.ifun;
     
     // ALU操作
     if (icode == Y86::OPQ) {
-        int64_t valA = static_cast<int64_t>(d_e.valA);
-        int64_t valB = static_cast<int64_t>(d_e.valB);
-        int64_t valE = 0;
-        
-        switch (ifun) {
-            case Y86::ADD:
-                valE = valA + valB;
-                break;
-            case Y86::SUB:
-                valE = valB - valA;  // subq %rA,%rB: rB = rB - rA
-                break;
-            case Y86::AND:
-                valE = valA & valB;
-                break;
-            case Y86::XOR:
-                valE = valA ^ valB;
-                break;
-        }
-        
-        // 计算新的条件码
+        // 与功能级模拟器共用 Y86::aluOp，同时更新全局CC_（用于后续的条件判断）
+        int64_t valE = Y86::aluOp(ifun, static_cast<int64_t>(ops.valA),
+                                  static_cast<int64_t>(ops.valB), CC_);
         e_m.set_cc = true;
-        e_m.CC.ZF = (valE == 0);
-        e_m.CC.SF = (valE < 0);
-        // 溢出检测
-        // 对于 valE = valB - valA:
-        //   overflow if (valB > 0 && valA < 0 && valE < 0): positive - negative -> should be positive, overflow if negative
-        //   overflow if (valB < 0 && valA > 0 && valE > 0): negative - positive -> should be negative, overflow if positive
-        bool overflow = false;
-        if (ifun == Y86::ADD) {
-            overflow = ((valA > 0 && valB > 0 && valE < 0) ||
-                       (valA < 0 && valB < 0 && valE > 0));
-        } else if (ifun == Y86::SUB) {
-            overflow = ((valA < 0 && valB > 0 && valE < 0) ||
-                       (valA > 0 && valB < 0 && valE > 0));
-        }
-        e_m.CC.OF = overflow;
-        
-        // 同时更新全局CC_（用于后续的条件判断）
-        setConditionCodes(ifun, valA, valB, valE);
-        
+        e_m.CC = CC_;
         e_m.valE = static_cast<uint64_t>(valE);
         
     } else if (icode == Y86::IRMOVQ) {
@@ -276,7 +234,7 @@ void PipelineSimulator::execute(const D_E_Register& d_e, E_M_Register& e_m) {
         e_m.Cnd = true;  // 无条件移动
         
     } else if (icode == Y86::RRMOVQ) {  // RRMOVQ和CMOVXX都是icode=2
-        e_m.valE = d_e.valA;  // 源寄存器的值
+        e_m.valE = ops.valA;  // 源寄存器的值
         if (ifun == 0) {
             // rrmovq: 无条件移动
             e_m.Cnd = true;
@@ -286,20 +244,20 @@ void PipelineSimulator::execute(const D_E_Register& d_e, E_M_Register& e_m) {
         }
         
     } else if (icode == Y86::RMMOVQ || icode == Y86::MRMOVQ) {
-        e_m.valE = d_e.valB + d_e.valC;  // 计算有效地址
+        e_m.valE = ops.valB + d_e.valC;  // 计算有效地址
         
     } else if (icode == Y86::PUSHQ || icode == Y86::CALL) {
-        e_m.valE = d_e.valB - 8;  // RSP - 8
+        e_m.valE = ops.valB - 8;  // RSP - 8
         
     } else if (icode == Y86::POPQ || icode == Y86::RET) {
-        e_m.valE = d_e.valB + 8;  // RSP + 8
+        e_m.valE = ops.valB + 8;  // RSP + 8
         
     } else if (icode == Y86::JXX) {
         e_m.Cnd = getCondition(ifun);
         // PC更新在主循环中根据Cnd处理
         
     } else if (icode == Y86::CALL) {
-        e_m.valE = d_e.valB - 8;  // RSP - 8（已在上面处理）
+        e_m.valE = ops.valB - 8;  // RSP - 8（已在上面处理）
         e_m.Cnd = true;  // CALL总是执行
         
     } else {
@@ -320,6 +278,7 @@ void PipelineSimulator::memory(const E_M_Register& e_m, M_W_Register& m_w) {
     m_w.valE = e_m.valE;
     m_w.valP = e_m.valP;  // 保存下一条PC
     m_w.valC = e_m.valC;  // 保存跳转目标地址（用于CALL和JXX）
+    m_w.pc = e_m.pc;
     m_w.dstE = e_m.dstE;
     m_w.dstM = e_m.dstM;
     m_w.Cnd = e_m.Cnd;    // 保存条件判断结果
@@ -328,6 +287,8 @@ void PipelineSimulator::memory(const E_M_Register& e_m, M_W_Register& m_w) {
     m_w.stat = e_m.stat;
     m_w.valid = e_m.valid;
     m_w.is_bubble = e_m.is_bubble;  // 传递bubble标志
+    m_w.cause = e_m.cause;
+    m_w.valM = 0;
     
     uint8_t icode = e_m.icode;
     
@@ -343,14 +304,14 @@ void PipelineSimulator::memory(const E_M_Register& e_m, M_W_Register& m_w) {
         try {
             m_w.valM = mem_.read64(e_m.valA);  // 使用旧的RSP值（在decode阶段读取）
             // RET指令：在M阶段结束时立即更新PC，并设置flush信号
-            if (icode == Y86::RET && m_w.stat == Y86::STAT_AOK) {
+            // （RAS预测正确时取指已经在正确路径上，不需要更新）
+            if (icode == Y86::RET && m_w.stat == Y86::STAT_AOK &&
+                !(e_m.ras_predicted && e_m.pred_pc == m_w.valM)) {
                 PC_ = m_w.valM;  // 立即更新PC为返回地址
             }
         } catch (...) {
             m_w.stat = Y86::STAT_ADR;
         }
-    } else {
-        m_w.valM = 0;
     }
     
     if (icode == Y86::RMMOVQ || icode == Y86::PUSHQ) {
@@ -426,6 +387,10 @@ void PipelineSimulator::writeBack(const M_W_Register& m_w) {
     
     // 统计完成的指令
     instruction_count_++;
+    detail_.retired_by_icode[icode & 0xF]++;
+    if (profiler_) {
+        profiler_->retire(m_w.pc, icode, m_w.valC);
+    }
     
     // 检查停机（在记录状态之前设置STAT，这样HALT记录的状态就是STAT=2）
     if (icode == Y86::HALT) {
@@ -458,76 +423,63 @@ void PipelineSimulator::writeBack(const M_W_Register& m_w) {
     recordState(pc_to_record, cc_for_record);
 }
 
-// 数据转发
-void PipelineSimulator::applyForwarding(D_E_Register& d_e) {
-    // 转发源A
-    if (d_e.srcA != Y86::RNONE) {
-        // 从E/M阶段转发（注意：CMOVXX with Cnd=false 不应该转发dstE）
-        bool e_m_can_forward_E = (e_m_.dstE == d_e.srcA && e_m_.dstE != Y86::RNONE);
-        // 对于CMOVXX（icode=2, ifun!=0），只有当Cnd=true时才转发
-        if (e_m_.icode == Y86::RRMOVQ && e_m_.valid) {
-            // RRMOVQ/CMOVXX: ifun=0 是 rrmovq（总是转发），ifun!=0 是 cmovxx（只在Cnd=true时转发）
-            // 但我们在这里没有ifun信息，需要用Cnd来判断
-            // 如果Cnd=false且是条件移动，不应该转发
-            if (!e_m_.Cnd) {
-                e_m_can_forward_E = false;
-            }
+namespace {
+
+// 为一个源寄存器选择转发来源：E/M.valE 优先于 M/W.valE，再次是 M/W.valM，否则保留寄存器文件的值
+// （CMOVXX 条件不成立时不写回 dstE，也就不能转发 valE）
+inline uint8_t forwardOperand(uint8_t src, uint64_t& val, const E_M_Register& e_m, const M_W_Register& m_w) {
+    if (e_m.valid && e_m.dstE == src && !(e_m.icode == Y86::RRMOVQ && !e_m.Cnd)) {
+        val = e_m.valE;
+        return Forward::E_M_VALE;
+    }
+    if (m_w.valid) {
+        if (m_w.dstE == src && !(m_w.icode == Y86::RRMOVQ && !m_w.Cnd)) {
+            val = m_w.valE;
+            return Forward::M_W_VALE;
         }
-        if (e_m_can_forward_E) {
-            d_e.valA = e_m_.valE;
+        if (m_w.dstM == src) {
+            val = m_w.valM;
+            return Forward::M_W_VALM;
         }
-        // 从M/W阶段转发（同样需要检查CMOVXX）
-        else {
-            bool m_w_can_forward_E = (m_w_.dstE == d_e.srcA && m_w_.dstE != Y86::RNONE);
-            if (m_w_.icode == Y86::RRMOVQ && m_w_.valid) {
-                if (!m_w_.Cnd) {
-                    m_w_can_forward_E = false;
-                }
-            }
-            if (m_w_can_forward_E) {
-                d_e.valA = m_w_.valE;
-            }
-            else if (m_w_.dstM == d_e.srcA && m_w_.dstM != Y86::RNONE) {
-                d_e.valA = m_w_.valM;
-            }
+    }
+    return Forward::REGFILE;
+}
+
+}  // namespace
+
+// 数据转发
+ExecuteOperands PipelineSimulator::applyForwarding(const D_E_Register& d_e, const E_M_Register& e_m,
+                                                   const M_W_Register& m_w, const M_W_Register* load_bypass) {
+    ExecuteOperands ops;
+    ops.valA = d_e.valA;
+    ops.valB = d_e.valB;
+    // 访存->执行旁路：E/M中的加载指令刚在M阶段读出的值是最新的
+    // （dstM在写回时晚于dstE写入，所以优先于同一条指令的dstE）
+    bool bypass_ok = load_bypass && e_m.valid;
+    if (d_e.srcA != Y86::RNONE) {
+        if (bypass_ok && e_m.dstM == d_e.srcA) {
+            ops.valA = load_bypass->valM;
+            ops.src_A = Forward::LOAD_BYPASS;
+        } else {
+            ops.src_A = forwardOperand(d_e.srcA, ops.valA, e_m, m_w);
         }
     }
-    
-    // 转发源B
     if (d_e.srcB != Y86::RNONE) {
-        // 从E/M阶段转发
-        bool e_m_can_forward_E = (e_m_.dstE == d_e.srcB && e_m_.dstE != Y86::RNONE);
-        if (e_m_.icode == Y86::RRMOVQ && e_m_.valid) {
-            if (!e_m_.Cnd) {
-                e_m_can_forward_E = false;
-            }
-        }
-        if (e_m_can_forward_E) {
-            d_e.valB = e_m_.valE;
-        }
-        // 从M/W阶段转发
-        else {
-            bool m_w_can_forward_E = (m_w_.dstE == d_e.srcB && m_w_.dstE != Y86::RNONE);
-            if (m_w_.icode == Y86::RRMOVQ && m_w_.valid) {
-                if (!m_w_.Cnd) {
-                    m_w_can_forward_E = false;
-                }
-            }
-            if (m_w_can_forward_E) {
-                d_e.valB = m_w_.valE;
-            }
-            else if (m_w_.dstM == d_e.srcB && m_w_.dstM != Y86::RNONE) {
-                d_e.valB = m_w_.valM;
-            }
+        if (bypass_ok && e_m.dstM == d_e.srcB) {
+            ops.valB = load_bypass->valM;
+            ops.src_B = Forward::LOAD_BYPASS;
+        } else {
+            ops.src_B = forwardOperand(d_e.srcB, ops.valB, e_m, m_w);
         }
     }
+    return ops;
 }
 
 // 检查是否需要停顿（Load/Use Hazard）
 bool PipelineSimulator::needStall(const D_E_Register& d_e, const E_M_Register& e_m) const {
     // Load/Use Hazard: E/M阶段的指令（MRMOVQ或POPQ）从内存读取数据
     // D/E阶段的指令需要使用这个数据，但数据还没准备好
-    if (e_m.icode == Y86::MRMOVQ || e_m.icode == Y86::POPQ) {
+    if (e_m.valid && (e_m.icode == Y86::MRMOVQ || e_m.icode == Y86::POPQ)) {
         uint8_t dstM = e_m.dstM;
         if (dstM != Y86::RNONE && d_e.valid) {
             // 检查D/E阶段指令是否需要这个寄存器
@@ -564,93 +516,216 @@ bool PipelineSimulator::needBubble(const D_E_Register& d_e, const E_M_Register&
     return false;
 }
 
-// 设置条件码
-void PipelineSimulator::setConditionCodes(uint8_t ifun, int64_t valA, int64_t valB, int64_t valE) {
-    CC_.ZF = (valE == 0);
-    CC_.SF = (valE < 0);
-    
-    // 溢出检测
-    // 对于 valE = valB - valA:
-    //   overflow if (valB > 0 && valA < 0 && valE < 0): positive - negative -> should be positive, overflow if negative
-    //   overflow if (valB < 0 && valA > 0 && valE > 0): negative - positive -> should be negative, overflow if positive
-    bool overflow = false;
-    switch (ifun) {
-        case Y86::ADD:
-            overflow = ((valA > 0 && valB > 0 && valE < 0) ||
-                       (valA < 0 && valB < 0 && valE > 0));
-            break;
-        case Y86::SUB:
-            overflow = ((valA < 0 && valB > 0 && valE < 0) ||
-                       (valA > 0 && valB < 0 && valE > 0));
-            break;
+// I-cache：新的取指地址访问缓存，缺失时取指阶段停顿 penalty 个周期后再取指
+// （等待期间被冲刷到其他地址时放弃等待，已经开始填入的行仍然有效）
+bool PipelineSimulator::fetchMissStall() {
+    if (STAT_ != Y86::STAT_AOK) {
+        return false;
+    }
+    if (!fetch_accessed_ || fetch_miss_pc_ != PC_) {
+        const Instruction& inst = decode_cache_.lookup(mem_, PC_);
+        fetch_wait_ = icache_->access(PC_, std::max<unsigned>(inst.length, 1), false);
+        fetch_miss_pc_ = PC_;
+        fetch_accessed_ = true;
+    }
+    if (fetch_wait_ > 0) {
+        fetch_wait_--;
+        return true;
+    }
+    fetch_accessed_ = false;
+    return false;
+}
+
+// D-cache：E/M 中的访存指令第一次到达M阶段时访问缓存，缺失时停顿 penalty 个周期
+bool PipelineSimulator::memoryMissStall(const E_M_Register& e_m) {
+    if (!memory_accessed_) {
+        uint8_t icode = e_m.icode;
+        if (e_m.is_bubble || e_m.stat != Y86::STAT_AOK) {
+            return false;
+        }
+        if (icode == Y86::MRMOVQ) {
+            memory_wait_ = dcache_->access(e_m.valE, 8, false);
+        } else if (icode == Y86::POPQ || icode == Y86::RET) {
+            memory_wait_ = dcache_->access(e_m.valA, 8, false);
+        } else if (icode == Y86::RMMOVQ || icode == Y86::PUSHQ || icode == Y86::CALL) {
+            memory_wait_ = dcache_->access(e_m.valE, 8, true);
+        } else {
+            return false;
+        }
+        memory_accessed_ = true;
+    }
+    if (memory_wait_ > 0) {
+        memory_wait_--;
+        return true;
+    }
+    memory_accessed_ = false;
+    return false;
+}
+
+void PipelineSimulator::refreshOperands(D_E_Register& d_e) const {
+    if (d_e.srcA != Y86::RNONE) {
+        d_e.valA = regs_.get(d_e.srcA);
+    }
+    if (d_e.srcB != Y86::RNONE) {
+        d_e.valB = regs_.get(d_e.srcB);
     }
-    CC_.OF = overflow;
 }
 
 // 获取条件判断结果
 bool PipelineSimulator::getCondition(uint8_t ifun) const {
-    switch (ifun) {
-        case Y86::C_YES: return true;
-        case Y86::C_LE: return ((CC_.SF || CC_.ZF) && !CC_.OF) || ((!CC_.SF && !CC_.ZF) && CC_.OF);
-        case Y86::C_L: return CC_.SF != CC_.OF;
-        case Y86::C_E: return CC_.ZF;
-        case Y86::C_NE: return !CC_.ZF;
-        case Y86::C_GE: return CC_.SF == CC_.OF;
-        case Y86::C_G: return !CC_.ZF && (CC_.SF == CC_.OF);
-        default: return false;
-    }
+    return Y86::evalCondition(ifun, CC_);
 }
 
 // 记录状态（使用指令完成时的PC和条件码）
 void PipelineSimulator::recordState(uint64_t instructionPC, const ConditionCodes& cc) {
-    State state;
-    state.PC = instructionPC;  // 使用指令完成时的PC
-    state.regs = regs_;
-    state.mem_snapshot = mem_.getNonZeroMemory();  // 保存当时的内存快照
-    state.CC = cc;
-    state.STAT = STAT_;
-    states_.push_back(state);
+    // 只记录相对上一状态的变化（寄存器、脏内存字、CC），PC使用指令完成时的PC
+    trace_.append(instructionPC, regs_, mem_, cc, STAT_);
+    mem_.clearDirty();
+    if (sink_) {
+        sink_(trace_.back());
+    }
+}
+
+const char* SlotCause::name(Cause cause) {
+    switch (cause) {
+        case FILL: return "fill";
+        case LOAD_USE: return "load_use_stall";
+        case RET_FLUSH: return "ret_flush";
+        case JXX_FLUSH: return "jxx_flush";
+        case CONTROL_BUBBLE: return "control_bubble";
+        case ICACHE_MISS: return "icache_stall";
+        case DCACHE_MISS: return "dcache_stall";
+        case DRAIN: return "drain";
+        default: return "other";
+    }
+}
+
+namespace {
+
+// 流水线插入的气泡：有效但不退休，其余字段为默认值（NOP、RNONE、STAT_AOK）
+template <typename Latch>
+Latch makeBubble(SlotCause::Cause cause) {
+    Latch latch;
+    latch.valid = true;
+    latch.is_bubble = true;
+    latch.cause = cause;
+    return latch;
+}
+
+template <typename Latch>
+StageSlot stageSlot(const Latch& latch, bool bubble) {
+    StageSlot slot;
+    if (!latch.valid) return slot;
+    if (bubble) {
+        slot.kind = StageSlot::BUBBLE;
+        return slot;
+    }
+    slot.kind = StageSlot::INST;
+    slot.pc = latch.pc;
+    slot.icode = latch.icode;
+    return slot;
+}
+
+}  // namespace
+
+// F 为本周期取指的结果（停顿时为保持不变的 F/D），其余阶段为本周期开始时各流水线寄存器的内容
+void PipelineSimulator::traceCycle(const F_D_Register& f, const F_D_Register& d, const D_E_Register& e,
+                                   const E_M_Register& m, const M_W_Register& w, uint8_t events,
+                                   const ExecuteOperands& ops) {
+    CycleRecord& rec = tracer_->push();
+    rec.cycle = cycle_count_;
+    rec.stage[CycleRecord::F] = stageSlot(f, false);
+    rec.stage[CycleRecord::D] = stageSlot(d, false);
+    rec.stage[CycleRecord::E] = stageSlot(e, e.is_bubble);
+    rec.stage[CycleRecord::M] = stageSlot(m, m.is_bubble);
+    rec.stage[CycleRecord::W] = stageSlot(w, w.is_bubble);
+    rec.events = events;
+    rec.fwd_A = ops.src_A;
+    rec.fwd_B = ops.src_B;
 }
 
 // 主运行循环
 void PipelineSimulator::run() {
-    // 循环条件：STAT正常且未停机，或者已停机但流水线还未排空
-    while ((STAT_ == Y86::STAT_AOK && !halted_) || 
-           (halted_ && (f_d_.valid || d_e_.valid || e_m_.valid || m_w_.valid))) {
+    // 循环条件：STAT正常且未停机，或者已停机但流水线还未排空（外部请求停止时立即结束）
+    while (!stop_requested_ &&
+           ((STAT_ == Y86::STAT_AOK && !halted_) || 
+            (halted_ && !latches_[cur_].empty()))) {
         cycle_count_++;
         
         // 从后往前执行（W -> M -> E -> D -> F）
-        // 保存当前周期的流水线寄存器状态（用于冒险检测和控制流）
-        M_W_Register m_w_prev = m_w_;
-        E_M_Register e_m_prev = e_m_;
-        D_E_Register d_e_prev = d_e_;
-        F_D_Register f_d_prev = f_d_;
-        
-        // 创建新的流水线寄存器（用于下一个周期）
-        M_W_Register m_w_new = m_w_;
-        E_M_Register e_m_new = e_m_;
-        D_E_Register d_e_new = d_e_;
-        F_D_Register f_d_new = f_d_;
+        // in 为本周期开始时的流水线寄存器（冒险检测和控制流都基于它），各阶段只读取 in、
+        // 并把下一个周期的内容完整写入 out，周期结束时翻转 cur_（不复制、不临时交换寄存器）
+        const PipelineLatches& in = latches_[cur_];
+        PipelineLatches& out = latches_[cur_ ^ 1];
         
         // 1. WriteBack阶段（先执行，记录当前完成指令的状态）
-        if (m_w_.valid) {
-            writeBack(m_w_);
+        uint64_t retired_before = instruction_count_;
+        bool halted_before = halted_;
+        if (in.m_w.valid) {
+            writeBack(in.m_w);
+        }
+        // 没有指令退休的周期按写回阶段空位的来源计数（每个周期恰好计入一类）
+        if (instruction_count_ == retired_before) {
+            SlotCause::Cause cause = static_cast<SlotCause::Cause>(in.m_w.cause);
+            if (halted_before) {
+                cause = SlotCause::DRAIN;
+            } else if (in.m_w.valid && !in.m_w.is_bubble) {
+                cause = SlotCause::OTHER;  // 出错的指令
+            }
+            detail_.lost_cycles[cause]++;
+            if (cause == SlotCause::FILL) {
+                detail_.fill_cycles++;
+            }
+            if (cause == SlotCause::RET_FLUSH || cause == SlotCause::JXX_FLUSH ||
+                cause == SlotCause::CONTROL_BUBBLE) {
+                bubble_cycles_++;
+            }
+        }
+        
+        // D-cache缺失：M阶段的指令等待，E/M及之前的流水线寄存器保持不变，M/W插入气泡
+        if (dcache_ && in.e_m.valid && memoryMissStall(in.e_m)) {
+            out.m_w = makeBubble<M_W_Register>(SlotCause::DCACHE_MISS);
+            out.e_m = in.e_m;
+            out.d_e = in.d_e;
+            refreshOperands(out.d_e);
+            out.f_d = in.f_d;
+            dcache_stall_cycles_++;
+            if (profiler_) {
+                profiler_->stall(in.e_m.pc);
+            }
+            if (tracer_) {
+                traceCycle(in.f_d, in.f_d, in.d_e, in.e_m, in.m_w, CycleEvent::DCACHE_MISS, ExecuteOperands());
+            }
+            cur_ ^= 1;
+            continue;
         }
         
         // 2. Memory阶段
-        if (e_m_prev.valid) {
-            memory(e_m_prev, m_w_new);
+        if (in.e_m.valid) {
+            memory(in.e_m, out.m_w);
         } else {
-            m_w_new.valid = false;
+            out.m_w.valid = false;
+            out.m_w.cause = in.e_m.cause;
         }
         
         // 5. 检查冒险（在execute之前检查，使用执行前的状态）
-        bool stall = needStall(d_e_prev, e_m_prev);
-        bool bubble = needBubble(d_e_prev, e_m_prev);
+        // 启用访存->执行旁路时，Load/Use冒险不再停顿，改为在执行前从 out.m_w 转发
+        bool load_use = needStall(in.d_e, in.e_m);
+        bool stall = load_use && !load_use_bypass_;
+        bool bubble = needBubble(in.d_e, in.e_m);
+        if (load_use && load_use_bypass_) {
+            load_use_bypasses_++;
+        }
         
         // 统计Stall周期
         if (stall) {
             stall_cycles_++;
+            if (in.e_m.dstM < 15) {
+                detail_.load_use_stalls_by_reg[in.e_m.dstM]++;
+            }
+            if (profiler_) {
+                profiler_->stall(in.e_m.pc);
+            }
         }
         
         // 处理跳转和控制流 - 暂时不检查，会在execute之后检查
@@ -658,170 +733,181 @@ void PipelineSimulator::run() {
         
         // RET指令处理（PC已在M阶段更新，这里只需要处理flush）
         // RET指令在M阶段结束时已经更新了PC，现在需要flush流水线
-        // 检查m_w_new（当前周期memory阶段的结果）是否包含RET指令
+        // 检查 out.m_w（当前周期memory阶段的结果）是否包含RET指令
         bool ret_flush = false;
-        if (m_w_new.valid && m_w_new.icode == Y86::RET && m_w_new.stat == Y86::STAT_AOK) {
-            // RET指令刚刚完成M阶段，需要flush F/D、D/E、E/M三个阶段
-            ret_flush = true;
+        bool ras_hit = false;
+        if (out.m_w.valid && out.m_w.icode == Y86::RET && out.m_w.stat == Y86::STAT_AOK) {
+            if (in.e_m.ras_predicted && in.e_m.pred_pc == out.m_w.valM) {
+                // RAS预测正确：后续指令已经在正确路径上
+                ras_hits_++;
+                ras_hit = true;
+            } else {
+                // RET指令刚刚完成M阶段，需要flush F/D、D/E、E/M三个阶段
+                ret_flush = true;
+                detail_.ret_flushes++;
+                if (profiler_) {
+                    profiler_->flush(out.m_w.pc, 3);
+                }
+                if (ras_.enabled()) {
+                    ras_misses_++;
+                }
+            }
         }
         
-        // Execute 阶段：执行 d_e_prev 中的指令
-        // 首先对 d_e_prev 应用转发（从 e_m_prev 和 m_w_prev 获取最新数据）
-        D_E_Register d_e_for_execute = d_e_prev;
-        if (d_e_for_execute.valid && !stall) {
-            // 临时保存e_m_和m_w_，用于转发
-            E_M_Register e_m_temp = e_m_;
-            M_W_Register m_w_temp = m_w_;
-            e_m_ = e_m_prev;
-            m_w_ = m_w_prev;
-            applyForwarding(d_e_for_execute);
-            e_m_ = e_m_temp;
-            m_w_ = m_w_temp;
-            
-            // 执行
-            execute(d_e_for_execute, e_m_new);
-        } else if (stall) {
+        // RET flush时，本周期执行的是错误路径上的指令，不能让它改写条件码
+        ConditionCodes cc_before_execute = CC_;
+        
+        // Execute 阶段：执行 in.d_e 中的指令，操作数从 in.e_m 和 in.m_w 转发
+        ExecuteOperands ops;
+        if (stall) {
             // Load/Use Hazard stall: 在E/M阶段插入bubble
-            e_m_new.icode = Y86::NOP;
-            e_m_new.valA = 0;
-            e_m_new.valC = 0;
-            e_m_new.valE = 0;
-            e_m_new.valP = 0;
-            e_m_new.dstE = Y86::RNONE;
-            e_m_new.dstM = Y86::RNONE;
-            e_m_new.Cnd = false;
-            e_m_new.set_cc = false;
-            e_m_new.stat = Y86::STAT_AOK;
-            e_m_new.valid = true;
-            e_m_new.is_bubble = true;  // 标记为bubble
+            out.e_m = makeBubble<E_M_Register>(SlotCause::LOAD_USE);
+        } else if (in.d_e.valid) {
+            ops = applyForwarding(in.d_e, in.e_m, in.m_w, load_use_bypass_ ? &out.m_w : nullptr);
+            detail_.forward_sources[ops.src_A]++;
+            detail_.forward_sources[ops.src_B]++;
+            execute(in.d_e, ops, out.e_m);
         } else {
-            e_m_new.valid = false;
+            out.e_m.valid = false;
+            out.e_m.cause = in.d_e.cause;
+        }
+        
+        if (ret_flush) {
+            CC_ = cc_before_execute;
+            ras_ = ras_committed_;
+        } else if (out.e_m.valid && !out.e_m.is_bubble) {
+            // 已经执行的CALL/RET不会再被flush，更新提交的RAS
+            if (out.e_m.icode == Y86::CALL) {
+                ras_committed_.push(out.e_m.valP);
+            } else if (out.e_m.icode == Y86::RET) {
+                uint64_t ignored;
+                ras_committed_.pop(ignored);
+            }
         }
         
         // 处理跳转和控制流（在Execute阶段之后检测）
-        // 使用e_m_new（刚刚执行的指令）而不是e_m_prev
-        if (e_m_new.valid && e_m_new.icode == Y86::JXX) {
-            if (e_m_new.Cnd) {
-                // 跳转预测失败（预测不跳转但实际跳转），需要跳转
-                PC_ = e_m_new.valC;  // 跳转目标地址
-                // 设置flush标志，清空F/D和D/E阶段
+        // 使用 out.e_m（刚刚执行的指令）而不是 in.e_m
+        // （RET flush时本周期执行的指令在错误路径上，不处理）
+        if (!ret_flush && out.e_m.valid && !out.e_m.is_bubble && out.e_m.icode == Y86::JXX) {
+            const E_M_Register& jxx = out.e_m;
+            branch_count_++;
+            BranchSite& site = detail_.branch_sites[jxx.pc];
+            site.executed++;
+            predictor_->update(jxx.pc, jxx.valC, jxx.Cnd);
+            if (jxx.Cnd != jxx.pred_taken) {
+                // 预测失败：改为实际的下一条PC（跳转目标或valP），清空F/D和D/E阶段
+                PC_ = jxx.Cnd ? jxx.valC : jxx.valP;
                 jmp_flush = true;
-                f_d_new.valid = false;
+                mispredict_count_++;
+                site.mispredicts++;
+                if (profiler_) {
+                    profiler_->flush(jxx.pc, 2);
+                }
+                // 错误路径上取指的CALL/RET可能改动了RAS，恢复到提交状态
+                ras_ = ras_committed_;
             }
-            // 如果Cnd=false，预测正确（预测不跳转且实际不跳转），PC已经在fetch阶段设置为valP
+            // 预测正确时，PC已经在fetch阶段设置好
         }
         
-        // Decode 阶段：处理 f_d_prev，生成 d_e_new
+        // Decode 阶段：处理 in.f_d，生成 out.d_e
         if (stall) {
             // Load/Use Hazard stall: D/E寄存器保持不变
             // 但需要重新读取寄存器值，因为 writeBack 可能已经更新了寄存器
-            d_e_new = d_e_prev;
-            // 重新读取寄存器值（这样可以获取 stall 周期 writeBack 写入的最新值）
-            if (d_e_new.srcA != Y86::RNONE) {
-                d_e_new.valA = regs_.get(d_e_new.srcA);
-            }
-            if (d_e_new.srcB != Y86::RNONE) {
-                d_e_new.valB = regs_.get(d_e_new.srcB);
-            }
+            out.d_e = in.d_e;
+            refreshOperands(out.d_e);
         } else if (bubble || ret_flush || jmp_flush) {
             // 注入气泡（NOP）- 用于控制冒险、RET指令flush或JXX跳转flush
-            d_e_new.icode = Y86::NOP;
-            d_e_new.ifun = 0;
-            d_e_new.valA = 0;
-            d_e_new.valB = 0;
-            d_e_new.valC = 0;
-            d_e_new.valP = 0;
-            d_e_new.dstE = Y86::RNONE;
-            d_e_new.dstM = Y86::RNONE;
-            d_e_new.srcA = Y86::RNONE;
-            d_e_new.srcB = Y86::RNONE;
-            d_e_new.stat = Y86::STAT_AOK;
-            d_e_new.valid = true;
-            d_e_new.is_bubble = true;  // 标记为bubble
-            
-            // 统计Bubble周期（根据实际浪费的周期数）
-            // ret_flush: 3 cycles wasted (flush F/D, D/E, E/M)
-            // jmp_flush: 2 cycles wasted (flush F/D, D/E)
-            // plain bubble: 1 cycle wasted
+            // （损失的周期在气泡到达写回阶段时按来源计数）
             if (ret_flush) {
-                bubble_cycles_ += 3;
+                out.d_e = makeBubble<D_E_Register>(SlotCause::RET_FLUSH);
             } else if (jmp_flush) {
-                bubble_cycles_ += 2;
+                out.d_e = makeBubble<D_E_Register>(SlotCause::JXX_FLUSH);
             } else {
-                bubble_cycles_ += 1;
+                out.d_e = makeBubble<D_E_Register>(SlotCause::CONTROL_BUBBLE);
+                detail_.control_bubbles++;
             }
-        } else if (f_d_prev.valid) {
-            decode(f_d_prev, d_e_new);
+        } else if (in.f_d.valid) {
+            decode(in.f_d, out.d_e);
         } else {
-            // 如果f_d_无效，清空d_e_
-            d_e_new.valid = false;
+            // 如果 F/D 无效，D/E 也为空
+            out.d_e.valid = false;
+            out.d_e.cause = in.f_d.cause;
         }
         
         // RET指令flush：如果RET指令在M阶段，需要flush E/M阶段（注入bubble）
         if (ret_flush) {
-            e_m_new.icode = Y86::NOP;
-            e_m_new.valA = 0;
-            e_m_new.valC = 0;
-            e_m_new.valE = 0;
-            e_m_new.valP = 0;
-            e_m_new.dstE = Y86::RNONE;
-            e_m_new.dstM = Y86::RNONE;
-            e_m_new.Cnd = false;
-            e_m_new.stat = Y86::STAT_AOK;
-            e_m_new.valid = true;
-            e_m_new.is_bubble = true;  // 标记为bubble
+            out.e_m = makeBubble<E_M_Register>(SlotCause::RET_FLUSH);
         }
         
         // 7. Fetch阶段（如果不停顿）
         // 检查是否已经fetch过HALT指令（流水线中有HALT就不再fetch）
-        bool halt_in_pipeline = (f_d_prev.valid && f_d_prev.icode == Y86::HALT) ||
-                                (d_e_prev.valid && d_e_prev.icode == Y86::HALT) ||
-                                (e_m_prev.valid && e_m_prev.icode == Y86::HALT) ||
-                                (m_w_prev.valid && m_w_prev.icode == Y86::HALT);
-        if (!stall) {
-            if (ret_flush || jmp_flush || halt_in_pipeline) {
-                // RET或JXX跳转flush，或HALT在流水线中：不再fetch
-                f_d_new.valid = false;
+        bool icache_miss = false;
+        bool halt_in_pipeline = (in.f_d.valid && in.f_d.icode == Y86::HALT) ||
+                                (in.d_e.valid && in.d_e.icode == Y86::HALT) ||
+                                (in.e_m.valid && in.e_m.icode == Y86::HALT) ||
+                                (in.m_w.valid && in.m_w.icode == Y86::HALT);
+        if (stall) {
+            // 如果stall，保持 F/D 不变
+            out.f_d = in.f_d;
+        } else if (ret_flush || jmp_flush || halt_in_pipeline) {
+            // RET或JXX跳转flush，或HALT在流水线中：不再fetch
+            out.f_d.valid = false;
+            if (ret_flush) {
+                out.f_d.cause = SlotCause::RET_FLUSH;
+            } else if (jmp_flush) {
+                out.f_d.cause = SlotCause::JXX_FLUSH;
             } else {
-                fetch(f_d_new);
+                out.f_d.cause = SlotCause::DRAIN;
+                detail_.drain_cycles++;
+            }
+        } else if (icache_ && fetchMissStall()) {
+            // I-cache缺失：本周期不取指，向 F/D 送入空的流水线寄存器
+            out.f_d.valid = false;
+            out.f_d.cause = SlotCause::ICACHE_MISS;
+            icache_miss = true;
+            icache_stall_cycles_++;
+            if (profiler_) {
+                profiler_->stall(PC_);
             }
         } else {
-            // 如果stall，保持f_d_不变（不更新）
-            f_d_new = f_d_prev;
+            fetch(out.f_d);
+        }
+        
+        if (tracer_) {
+            uint8_t events = 0;
+            if (icache_miss) events |= CycleEvent::ICACHE_MISS;
+            if (stall) events |= CycleEvent::STALL;
+            if (bubble) events |= CycleEvent::BUBBLE;
+            if (ret_flush) events |= CycleEvent::RET_FLUSH;
+            if (jmp_flush) events |= CycleEvent::JXX_FLUSH;
+            if (load_use && load_use_bypass_) events |= CycleEvent::LOAD_BYPASS;
+            if (ras_hit) events |= CycleEvent::RAS_HIT;
+            traceCycle(out.f_d, in.f_d, in.d_e, in.e_m, in.m_w, events, ops);
         }
         
-        // 更新流水线寄存器：将新周期的值赋给当前寄存器
-        m_w_ = m_w_new;
-        e_m_ = e_m_new;
-        d_e_ = d_e_new;
-        f_d_ = f_d_new;
+        // 更新流水线寄存器：本周期的输出成为下一个周期的输入
+        cur_ ^= 1;
         
         // 检查是否所有阶段都为空且已停机（流水线排空）
         // 注意：halt指令在writeBack阶段设置halted_标志，但需要等待流水线排空
         if (halted_ || STAT_ != Y86::STAT_AOK) {
             // 如果已停机，等待流水线排空（所有阶段都无效）
-            if (!f_d_.valid && !d_e_.valid && !e_m_.valid && !m_w_.valid) {
+            if (latches_[cur_].empty()) {
                 // 如果STAT_=STAT_HLT，需要记录halt完成状态（STAT=2）
                 // 但只有在还没有记录过halt完成状态时才记录
-                if (STAT_ == Y86::STAT_HLT && !states_.empty() && states_.back().STAT == Y86::STAT_AOK) {
+                if (STAT_ == Y86::STAT_HLT && !trace_.empty() && trace_.back().STAT == Y86::STAT_AOK) {
                     // 使用最后一个状态的PC（halt指令的PC）
-                    recordState(states_.back().PC, CC_);
+                    recordState(trace_.back().PC, CC_);
                 }
                 // 流水线已排空，退出循环
                 break;
             }
         }
         
-        // 安全检查：防止无限循环
-        if (cycle_count_ > 1000000) {
+        // 防止无限循环：与其他引擎在相同的退休指令数处停止
+        if (instruction_count_ >= Y86::MAX_RETIRED) {
             STAT_ = Y86::STAT_INS;
             break;
         }
     }
-    
-    // 确保halt指令的状态被记录
-    if (halted_ && m_w_.valid && m_w_.icode == Y86::HALT) {
-        // halt指令的状态已经在writeBack阶段记录，这里不需要额外处理
-    }
 }
-
@@ -2,9 +2,38 @@
 #define PIPELINE_H
 
 #include "y86.h"
+#include "branch_predictor.h"
+#include "cache.h"
+#include "decode_cache.h"
+#include "trace.h"
+#include "loader.h"
+#include "cycle_trace.h"
+#include "profile.h"
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
+// 流水线寄存器中没有指令（气泡或无效）时，造成这个空位的原因。空位到达写回阶段的周期
+// 没有指令退休，按原因计入 DetailedCounters::lost_cycles，所以退休的指令数加上各原因的
+// 周期数恰好等于总周期数
+namespace SlotCause {
+    enum Cause : uint8_t {
+        FILL = 0,        // 流水线启动时的空阶段
+        LOAD_USE,        // Load/Use 停顿在 E/M 插入的气泡
+        RET_FLUSH,       // RET 冲刷 F/D、D/E、E/M
+        JXX_FLUSH,       // 分支预测失败冲刷 F/D、D/E
+        CONTROL_BUBBLE,  // 控制冒险在 D/E 插入的气泡
+        ICACHE_MISS,     // 取指等待 I-cache 缺失
+        DCACHE_MISS,     // 访存等待 D-cache 缺失时在 M/W 插入的气泡
+        DRAIN,           // HALT 进入流水线后不再取指，以及 HALT 退休之后
+        OTHER,           // 取指出错、执行出错的指令
+        NUM_CAUSES
+    };
+    const char* name(Cause cause);
+}
+
 // 流水线寄存器结构
 // F/D 寄存器：取指阶段输出，译码阶段输入
 struct F_D_Register {
@@ -15,9 +44,14 @@ struct F_D_Register {
     uint8_t rB = Y86::RNONE;
     uint64_t valC = 0;      // 立即数或地址
     uint64_t valP = 0;      // 下一条指令的PC
+    uint64_t pc = 0;        // 指令本身的地址
     bool need_regids = false;
     bool need_valC = false;
+    bool pred_taken = false;  // JXX：取指时是否预测跳转
+    bool ras_predicted = false;  // RET：取指时是否用RAS预测了返回地址
+    uint64_t pred_pc = 0;        // RET：RAS预测的返回地址
     uint8_t stat = Y86::STAT_AOK;
+    uint8_t cause = SlotCause::FILL;  // 无效时空位的来源（SlotCause）
 };
 
 // D/E 寄存器：译码阶段输出，执行阶段输入
@@ -30,11 +64,16 @@ struct D_E_Register {
     uint64_t valB = 0;     // 源操作数B（可能被转发修改）
     uint64_t valC = 0;     // 立即数
     uint64_t valP = 0;     // 指令的下一条PC（用于状态记录）
+    uint64_t pc = 0;       // 指令本身的地址
+    bool pred_taken = false;  // JXX：取指时是否预测跳转
+    bool ras_predicted = false;  // RET：取指时是否用RAS预测了返回地址
+    uint64_t pred_pc = 0;        // RET：RAS预测的返回地址
     uint8_t dstE = Y86::RNONE;  // 目标寄存器E
     uint8_t dstM = Y86::RNONE;  // 目标寄存器M
     uint8_t srcA = Y86::RNONE;  // 源寄存器A
     uint8_t srcB = Y86::RNONE;  // 源寄存器B
     uint8_t stat = Y86::STAT_AOK;
+    uint8_t cause = SlotCause::FILL;  // 气泡或无效时空位的来源（SlotCause）
 };
 
 // E/M 寄存器：执行阶段输出，访存阶段输入
@@ -46,12 +85,17 @@ struct E_M_Register {
     uint64_t valA = 0;     // 用于访存的数据
     uint64_t valC = 0;     // 跳转目标地址（用于JXX和CALL）
     uint64_t valP = 0;     // 指令的下一条PC（用于状态记录）
+    uint64_t pc = 0;       // 指令本身的地址
+    bool pred_taken = false;  // JXX：取指时是否预测跳转
+    bool ras_predicted = false;  // RET：取指时是否用RAS预测了返回地址
+    uint64_t pred_pc = 0;        // RET：RAS预测的返回地址
     uint8_t dstE = Y86::RNONE;
     uint8_t dstM = Y86::RNONE;
     bool Cnd = false;      // 条件码判断结果
     bool set_cc = false;   // 是否设置条件码
     ConditionCodes CC;     // 新的条件码值（用于OPQ指令）
     uint8_t stat = Y86::STAT_AOK;
+    uint8_t cause = SlotCause::FILL;  // 气泡或无效时空位的来源（SlotCause）
 };
 
 // M/W 寄存器：访存阶段输出，写回阶段输入
@@ -63,23 +107,33 @@ struct M_W_Register {
     uint64_t valM = 0;     // 内存读取结果
     uint64_t valP = 0;     // 指令的下一条PC（用于状态记录）
     uint64_t valC = 0;     // 跳转目标地址（用于CALL和JXX）
+    uint64_t pc = 0;       // 指令本身的地址
     uint8_t dstE = Y86::RNONE;
     uint8_t dstM = Y86::RNONE;
     bool Cnd = false;      // 条件码判断结果（用于CMOVXX）
     bool set_cc = false;   // 是否设置条件码
     ConditionCodes CC;     // 新的条件码值（用于OPQ指令）
     uint8_t stat = Y86::STAT_AOK;
+    uint8_t cause = SlotCause::FILL;  // 气泡或无效时空位的来源（SlotCause）
+};
+
+// 一个周期边界上的全部流水线寄存器
+struct PipelineLatches {
+    F_D_Register f_d;
+    D_E_Register d_e;
+    E_M_Register e_m;
+    M_W_Register m_w;
+    
+    // 所有阶段都为空（流水线已排空）
+    bool empty() const { return !f_d.valid && !d_e.valid && !e_m.valid && !m_w.valid; }
 };
 
-// 指令解析结果
-struct Instruction {
-    uint8_t icode;
-    uint8_t ifun;
-    uint8_t rA;
-    uint8_t rB;
-    uint64_t valC;
-    uint64_t length;  // 指令长度（字节）
-    uint8_t stat;
+// 执行阶段实际使用的操作数（转发之后）及其来源（Forward::Source）
+struct ExecuteOperands {
+    uint64_t valA = 0;
+    uint64_t valB = 0;
+    uint8_t src_A = Forward::NONE;
+    uint8_t src_B = Forward::NONE;
 };
 
 // 五级流水线模拟器
@@ -87,23 +141,50 @@ class PipelineSimulator {
 public:
     PipelineSimulator();
     
+    // 配置内存地址空间（在 loadProgram 之前调用，会清空内存）
+    void setMemoryConfig(const MemoryConfig& config) { mem_.configure(config); }
+    
     // 加载程序到内存
     void loadProgram(const std::vector<uint8_t>& program);
+    void loadProgram(const ProgramImage& image);
     
     // 运行模拟器
     void run();
+    // 请求在当前周期结束后停止 run()（可在状态回调中调用，例如校验发现不一致时）
+    void requestStop() { stop_requested_ = true; }
     
     // 获取当前状态（用于输出JSON）
-    struct State {
-        uint64_t PC;
-        RegisterFile regs;
-        std::map<uint64_t, int64_t> mem_snapshot;  // 保存当时的非零内存值快照
-        ConditionCodes CC;
-        uint8_t STAT;
-        
-        State() {}
+    using State = ArchState;
+    // 增量编码的退休状态日志，通过迭代器按需重建每个状态
+    const TraceLog& getTrace() const { return trace_; }
+    // 展开为完整状态列表（内存占用随指令数增长，仅用于小程序）
+    std::vector<State> getStates() const {
+        return std::vector<State>(trace_.begin(), trace_.end());
+    }
+    
+    // 状态回调：每条指令退休时立即调用（在 run() 内部），用于流式输出
+    using StateSink = std::function<void(const State&)>;
+    void setStateSink(StateSink sink) { sink_ = std::move(sink); }
+    // 是否在 TraceLog 中保留历史状态（只使用回调时可以关闭，内存占用不随指令数增长）
+    void setRecordTrace(bool record) { trace_.setRetain(record); }
+    
+    // 每个JXX指令（按PC）的执行和预测失败次数
+    struct BranchSite {
+        uint64_t executed = 0;
+        uint64_t mispredicts = 0;
+    };
+    // 详细计数器（--stats-json 导出）
+    struct DetailedCounters {
+        uint64_t retired_by_icode[16] = {};          // 按icode统计的退休指令数
+        uint64_t load_use_stalls_by_reg[15] = {};    // 按加载的目标寄存器统计的Load/Use停顿
+        uint64_t forward_sources[Forward::NUM_SOURCES] = {};  // 执行阶段操作数的来源（每个操作数计一次）
+        std::unordered_map<uint64_t, BranchSite> branch_sites;  // 按JXX指令PC统计
+        uint64_t ret_flushes = 0;       // RET冲刷次数
+        uint64_t control_bubbles = 0;   // 控制冒险插入的单周期气泡
+        uint64_t lost_cycles[SlotCause::NUM_CAUSES] = {};  // 没有指令退休的周期，按写回阶段空位的来源分类
+        uint64_t fill_cycles = 0;       // 流水线启动时的空阶段到达写回阶段的周期（不含等待缓存的周期）
+        uint64_t drain_cycles = 0;      // HALT进入流水线后取指阶段空闲的周期（流水线排空）
     };
-    std::vector<State> getStates() const { return states_; }
     
     // 性能统计接口
     struct PerformanceStats {
@@ -111,7 +192,19 @@ public:
         uint64_t instructions_retired;  // 已完成的指令数
         double ipc;                 // Instructions Per Cycle
         uint64_t stall_cycles;     // 停顿周期数（预留）
-        uint64_t bubble_cycles;    // 气泡周期数（预留）
+        uint64_t bubble_cycles;    // RET冲刷、JXX冲刷和控制冒险气泡到达写回阶段的周期数
+        uint64_t branches;         // 执行的JXX指令数
+        uint64_t branch_mispredicts;  // JXX预测失败次数
+        uint64_t ras_hits;         // RET返回地址预测正确次数
+        uint64_t ras_misses;       // RET预测错误或RAS为空（需要flush）的次数
+        uint64_t load_use_bypasses;  // 通过M->E旁路避免的Load/Use停顿周期数
+        uint64_t icache_stall_cycles;  // I-cache缺失使取指阶段停顿的周期数
+        uint64_t dcache_stall_cycles;  // D-cache缺失使访存阶段停顿的周期数
+        bool has_icache;
+        bool has_dcache;
+        Cache::Stats icache;
+        Cache::Stats dcache;
+        DetailedCounters detail;
     };
     PerformanceStats getPerformanceStats() const {
         PerformanceStats stats;
@@ -121,30 +214,81 @@ public:
             static_cast<double>(instruction_count_) / cycle_count_ : 0.0;
         stats.stall_cycles = stall_cycles_;
         stats.bubble_cycles = bubble_cycles_;
+        stats.branches = branch_count_;
+        stats.branch_mispredicts = mispredict_count_;
+        stats.ras_hits = ras_hits_;
+        stats.ras_misses = ras_misses_;
+        stats.load_use_bypasses = load_use_bypasses_;
+        stats.icache_stall_cycles = icache_stall_cycles_;
+        stats.dcache_stall_cycles = dcache_stall_cycles_;
+        stats.has_icache = (icache_ != nullptr);
+        stats.has_dcache = (dcache_ != nullptr);
+        stats.icache = icache_ ? icache_->stats() : Cache::Stats();
+        stats.dcache = dcache_ ? dcache_->stats() : Cache::Stats();
+        stats.detail = detail_;
         return stats;
     }
     
+    // 设置JXX分支预测器（默认总是预测不跳转）
+    void setBranchPredictor(std::unique_ptr<BranchPredictor> predictor) {
+        predictor_ = std::move(predictor);
+    }
+    const BranchPredictor& getBranchPredictor() const { return *predictor_; }
+    
+    // 设置返回地址栈深度（0 表示不使用RAS，RET等待M阶段读出返回地址）
+    void setReturnAddressStackDepth(size_t depth) {
+        ras_ = ReturnAddressStack(depth);
+        ras_committed_ = ReturnAddressStack(depth);
+    }
+    
+    // 是否启用访存->执行旁路：MRMOVQ/POPQ 在M阶段读出的值直接转发给同一周期
+    // 执行的下一条指令，代替Load/Use停顿（体系结构状态不变）
+    void setLoadUseBypass(bool enable) { load_use_bypass_ = enable; }
+    
+    // 在取指阶段和访存阶段与 Memory 之间加入指令缓存和数据缓存（默认没有缓存，
+    // 每次访问1个周期）；缺失时相应阶段停顿 miss_penalty 个周期，体系结构状态不变
+    void setICache(const Cache::Config& config) { icache_.reset(new Cache(config)); }
+    void setDCache(const Cache::Config& config) { dcache_.reset(new Cache(config)); }
+    
+    // 周期级跟踪：每个周期把各阶段内容和控制事件写入 tracer（nullptr 关闭）
+    void setCycleTracer(CycleTracer* tracer) { tracer_ = tracer; }
+    
+    // 按PC的热点分析：退休、停顿和冲刷事件报告给 profiler（nullptr 关闭）
+    void setProfiler(Profiler* profiler) { profiler_ = profiler; }
+    
 private:
-    // 五个流水线阶段
+    friend class PipelineBench;  // bench.cpp 直接测量转发逻辑
+    
+    // 五个流水线阶段：只读取参数给出的输入寄存器，结果完整写入输出寄存器
     void fetch(F_D_Register& f_d);
     void decode(const F_D_Register& f_d, D_E_Register& d_e);
-    void execute(const D_E_Register& d_e, E_M_Register& e_m);
+    void execute(const D_E_Register& d_e, const ExecuteOperands& ops, E_M_Register& e_m);
     void memory(const E_M_Register& e_m, M_W_Register& m_w);
     void writeBack(const M_W_Register& m_w);
     
     // 冒险控制
-    void applyForwarding(D_E_Register& d_e);
+    // 从本周期开始时的 E/M、M/W 为 d_e 选择操作数（只转发有效的流水线寄存器）；
+    // load_bypass 非空时，E/M中的加载指令本周期读出的值（M->E旁路）也参与转发
+    static ExecuteOperands applyForwarding(const D_E_Register& d_e, const E_M_Register& e_m,
+                                           const M_W_Register& m_w, const M_W_Register* load_bypass);
     bool needStall(const D_E_Register& d_e, const E_M_Register& e_m) const;
     bool needBubble(const D_E_Register& d_e, const E_M_Register& e_m) const;
+    // 缓存缺失停顿：本周期取指/访存阶段是否还在等待缓存行填入（每条指令第一次调用时访问缓存）
+    bool fetchMissStall();
+    bool memoryMissStall(const E_M_Register& e_m);
+    // 停顿时保持不变的 D/E 重新读取寄存器（同一周期写回的值不再能从 M/W 转发）
+    void refreshOperands(D_E_Register& d_e) const;
+    
+    // 记录一个周期的各阶段内容（只在挂接了 tracer_ 时调用）
+    void traceCycle(const F_D_Register& f, const F_D_Register& d, const D_E_Register& e,
+                    const E_M_Register& m, const M_W_Register& w, uint8_t events,
+                    const ExecuteOperands& ops);
     
     // 辅助函数
     Instruction parseInstruction(uint64_t pc) const;
-    bool needRegids(uint8_t icode) const;
-    bool needValC(uint8_t icode) const;
     uint64_t getPCNext(uint64_t pc, const Instruction& inst) const;
     
-    // 条件码计算
-    void setConditionCodes(uint8_t ifun, int64_t valA, int64_t valB, int64_t valE);
+    // 条件码判断
     bool getCondition(uint8_t ifun) const;
     
     // 状态记录
@@ -157,20 +301,52 @@ private:
     ConditionCodes CC_;
     uint8_t STAT_;
     
-    // 流水线寄存器
-    F_D_Register f_d_;
-    D_E_Register d_e_;
-    E_M_Register e_m_;
-    M_W_Register m_w_;
+    // JXX分支预测器
+    std::unique_ptr<BranchPredictor> predictor_;
+    // 返回地址栈：ras_ 在取指阶段推测更新；ras_committed_ 只随已执行（不会被flush）的
+    // CALL/RET 更新，预测失败flush时用它恢复 ras_
+    ReturnAddressStack ras_;
+    ReturnAddressStack ras_committed_;
+    
+    // 预译码指令缓存（Fetch阶段使用）
+    DecodeCache decode_cache_;
+    
+    // 指令缓存和数据缓存（nullptr 表示不使用），以及正在等待的缺失
+    std::unique_ptr<Cache> icache_;
+    std::unique_ptr<Cache> dcache_;
+    uint64_t fetch_miss_pc_ = 0;   // 已经访问过缓存、正在等待的取指地址
+    bool fetch_accessed_ = false;
+    unsigned fetch_wait_ = 0;      // 剩余的停顿周期
+    bool memory_accessed_ = false; // E/M 中的指令已经访问过数据缓存
+    unsigned memory_wait_ = 0;
+    
+    // 流水线寄存器（双缓冲）：latches_[cur_] 为当前周期的输入，另一组接收各阶段的输出，
+    // 周期结束时翻转 cur_
+    PipelineLatches latches_[2];
+    unsigned cur_ = 0;
     
     // 状态记录
-    std::vector<State> states_;
+    TraceLog trace_;
+    StateSink sink_;
     
     // 性能统计
     uint64_t cycle_count_;
     uint64_t instruction_count_;
     uint64_t stall_cycles_;      // Stall周期计数
     uint64_t bubble_cycles_;     // Bubble周期计数
+    uint64_t branch_count_;      // JXX指令数
+    uint64_t mispredict_count_;  // JXX预测失败次数
+    uint64_t ras_hits_;          // RAS预测正确次数
+    uint64_t ras_misses_;        // RAS预测错误或无法预测次数
+    uint64_t load_use_bypasses_; // 通过旁路避免的停顿次数
+    uint64_t icache_stall_cycles_ = 0;
+    uint64_t dcache_stall_cycles_ = 0;
+    DetailedCounters detail_;
+    bool load_use_bypass_ = false;
+    bool stop_requested_ = false;
+    
+    CycleTracer* tracer_ = nullptr;
+    Profiler* profiler_ = nullptr;
     
     // 是否已停机
     bool halted_;
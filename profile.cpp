@@ -0,0 +1,187 @@
+#include "profile.h"
+#include "y86.h"
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <string>
+
+namespace {
+
+// 行首的 "标号:"（.yo 中 '|' 右边的文本）
+bool parseLabel(const std::string& text, std::string& label) {
+    size_t i = 0;
+    if (text.empty() || !(std::isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_' || text[0] == '.')) {
+        return false;
+    }
+    while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '_' || text[i] == '.')) {
+        i++;
+    }
+    if (i == text.size() || text[i] != ':') return false;
+    label = text.substr(0, i);
+    return true;
+}
+
+double percent(uint64_t part, uint64_t total) {
+    return total ? 100.0 * static_cast<double>(part) / static_cast<double>(total) : 0.0;
+}
+
+}  // namespace
+
+void Profiler::clear() {
+    counters_.clear();
+    edges_.clear();
+    inclusive_.clear();
+    active_.clear();
+    stack_.clear();
+    attributed_ = 0;
+    entry_ = 0;
+    started_ = false;
+}
+
+void Profiler::retire(uint64_t pc, uint8_t icode, uint64_t target) {
+    if (!started_) {
+        entry_ = pc;
+        started_ = true;
+    }
+    uint64_t current = stack_.empty() ? entry_ : stack_.back().function;
+    PcCounters& counters = counters_[pc];
+    if (counters.retired++ == 0) {
+        counters.function = current;
+    }
+    attributed_++;
+
+    if (icode == Y86::CALL) {
+        edges_[{current, target}].calls++;
+        stack_.push_back({target, current, attributed_});
+        active_[target]++;
+    } else if (icode == Y86::RET && !stack_.empty()) {
+        Frame frame = stack_.back();
+        stack_.pop_back();
+        closeFrame(frame, attributed_, edges_, inclusive_, active_);
+    }
+}
+
+void Profiler::closeFrame(const Frame& frame, uint64_t end,
+                          std::map<std::pair<uint64_t, uint64_t>, CallEdge>& edges,
+                          std::unordered_map<uint64_t, uint64_t>& inclusive,
+                          std::unordered_map<uint64_t, uint64_t>& active) {
+    // 递归调用时只有最外层的帧计入，避免同一段时间被重复累加
+    if (--active[frame.function] == 0) {
+        uint64_t elapsed = end - frame.start;
+        inclusive[frame.function] += elapsed;
+        edges[{frame.caller, frame.function}].inclusive_cycles += elapsed;
+    }
+}
+
+void Profiler::report(FILE* out, const std::vector<SourceLine>& source, uint64_t total_cycles) const {
+    // 标号和每个地址的指令文本
+    std::unordered_map<uint64_t, std::string> labels;
+    std::unordered_map<uint64_t, const std::string*> inst_text;
+    for (const auto& line : source) {
+        std::string label;
+        if (parseLabel(line.text, label)) {
+            labels.emplace(line.addr, label);
+        }
+        if (line.has_bytes) {
+            inst_text.emplace(line.addr, &line.text);
+        }
+    }
+    auto functionName = [&](uint64_t addr) {
+        auto it = labels.find(addr);
+        if (it != labels.end()) return it->second;
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "0x%" PRIx64, addr);
+        return std::string(buf);
+    };
+    auto u = [](uint64_t v) { return static_cast<unsigned long long>(v); };
+
+    // 程序结束时仍在栈上的帧（如被调函数直接 halt）计到结束为止
+    auto edges = edges_;
+    auto inclusive = inclusive_;
+    auto active = active_;
+    for (auto it = stack_.rbegin(); it != stack_.rend(); ++it) {
+        closeFrame(*it, attributed_, edges, inclusive, active);
+    }
+    if (started_) {
+        inclusive[entry_] = attributed_;
+    }
+
+    // 平坦剖析
+    std::vector<std::pair<uint64_t, PcCounters>> flat(counters_.begin(), counters_.end());
+    std::sort(flat.begin(), flat.end(), [](const auto& a, const auto& b) {
+        if (a.second.cycles() != b.second.cycles()) return a.second.cycles() > b.second.cycles();
+        return a.first < b.first;
+    });
+    uint64_t retired = 0;
+    std::unordered_map<uint64_t, uint64_t> self;
+    for (const auto& entry : flat) {
+        retired += entry.second.retired;
+        self[entry.second.function] += entry.second.cycles();
+    }
+
+    std::fprintf(out, "# Flat profile: %llu cycles, %llu instructions retired, %llu cycles unattributed (pipeline fill)\n",
+                 u(total_cycles), u(retired), u(total_cycles > attributed_ ? total_cycles - attributed_ : 0));
+    std::fprintf(out, "#   cycles       %%  retired    stall    flush  pc        function          source\n");
+    for (const auto& entry : flat) {
+        const PcCounters& c = entry.second;
+        auto text = inst_text.find(entry.first);
+        std::fprintf(out, "%10llu  %5.1f%%  %7llu  %7llu  %7llu  0x%-6" PRIx64 "  %-16s  %s\n",
+                     u(c.cycles()), percent(c.cycles(), total_cycles), u(c.retired),
+                     u(c.stall_cycles), u(c.flush_cycles), entry.first,
+                     functionName(c.function).c_str(),
+                     text != inst_text.end() ? text->second->c_str() : "");
+    }
+
+    // 按函数汇总
+    std::unordered_map<uint64_t, uint64_t> calls;
+    for (const auto& edge : edges) {
+        calls[edge.first.second] += edge.second.calls;
+    }
+    std::vector<uint64_t> functions;
+    for (const auto& entry : self) functions.push_back(entry.first);
+    for (const auto& entry : inclusive) {
+        if (!self.count(entry.first)) functions.push_back(entry.first);
+    }
+    std::sort(functions.begin(), functions.end(), [&](uint64_t a, uint64_t b) {
+        if (inclusive[a] != inclusive[b]) return inclusive[a] > inclusive[b];
+        return a < b;
+    });
+    std::fprintf(out, "\n# Functions (self: cycles of the function's own instructions;"
+                 " inclusive: self plus callees, outermost call only)\n");
+    std::fprintf(out, "#     self       %%  inclusive       %%     calls  function\n");
+    for (uint64_t fn : functions) {
+        std::fprintf(out, "%10llu  %5.1f%%  %9llu  %5.1f%%  %8llu  %s\n",
+                     u(self[fn]), percent(self[fn], total_cycles),
+                     u(inclusive[fn]), percent(inclusive[fn], total_cycles),
+                     u(calls[fn]), functionName(fn).c_str());
+    }
+
+    // 调用图
+    std::fprintf(out, "\n# Call graph\n");
+    std::fprintf(out, "#    calls  inclusive  caller -> callee\n");
+    for (const auto& edge : edges) {
+        std::fprintf(out, "%10llu  %9llu  %s -> %s\n", u(edge.second.calls),
+                     u(edge.second.inclusive_cycles), functionName(edge.first.first).c_str(),
+                     functionName(edge.first.second).c_str());
+    }
+
+    // 带计数的源程序清单
+    std::fprintf(out, "\n# Annotated source\n");
+    if (source.empty()) {
+        std::fprintf(out, "# (no source text: the program was not loaded from a .yo file)\n");
+        return;
+    }
+    std::fprintf(out, "#   cycles  retired    stall    flush  | source\n");
+    for (const auto& line : source) {
+        auto it = line.has_bytes ? counters_.find(line.addr) : counters_.end();
+        if (it != counters_.end()) {
+            const PcCounters& c = it->second;
+            std::fprintf(out, "%10llu  %7llu  %7llu  %7llu  | 0x%03" PRIx64 ": %s\n",
+                         u(c.cycles()), u(c.retired), u(c.stall_cycles), u(c.flush_cycles),
+                         line.addr, line.text.c_str());
+        } else {
+            std::fprintf(out, "%10s  %7s  %7s  %7s  | 0x%03" PRIx64 ": %s\n", "", "", "", "",
+                         line.addr, line.text.c_str());
+        }
+    }
+}
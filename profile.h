@@ -0,0 +1,77 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "loader.h"
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 按PC的热点分析：把周期、Load/Use停顿和冲刷损失归到负责的指令上，
+// 并按退休的 CALL/RET 配对构建调用图。由 PipelineSimulator::setProfiler 挂接。
+//
+// 周期归属：每条退休的指令计1个周期；Load/Use 停顿计到造成停顿的加载指令；
+// RET 冲刷（3周期）计到该 RET，预测失败的 JXX（2周期）计到该 JXX。
+// 第一条指令退休前的流水线填充周期不归属任何指令。
+class Profiler {
+public:
+    struct PcCounters {
+        uint64_t retired = 0;
+        uint64_t stall_cycles = 0;
+        uint64_t flush_cycles = 0;
+        uint64_t function = 0;  // 第一次退休时所在函数的入口地址
+        uint64_t cycles() const { return retired + stall_cycles + flush_cycles; }
+    };
+    struct CallEdge {
+        uint64_t calls = 0;
+        uint64_t inclusive_cycles = 0;  // 从 CALL 退休到对应 RET 退休之间归属的周期（递归内层不重复计入）
+    };
+
+    void clear();
+
+    // 流水线事件（只在挂接时调用）
+    // target 为 CALL 的目标地址，其他指令忽略
+    void retire(uint64_t pc, uint8_t icode, uint64_t target);
+    void stall(uint64_t pc) {
+        counters_[pc].stall_cycles++;
+        attributed_++;
+    }
+    void flush(uint64_t pc, uint64_t cycles) {
+        counters_[pc].flush_cycles += cycles;
+        attributed_ += cycles;
+    }
+
+    const std::unordered_map<uint64_t, PcCounters>& counters() const { return counters_; }
+
+    // 文本报告：平坦剖析、按函数汇总、调用图，以及带计数的源程序清单
+    // （source 为空时省略清单，函数名退化为入口地址）。total_cycles 用于计算百分比
+    void report(FILE* out, const std::vector<SourceLine>& source, uint64_t total_cycles) const;
+
+private:
+    // 调用帧的时间用已归属周期的累计值计算：一条指令的停顿和冲刷损失都在它退休之前发生，
+    // 所以 RET 退休时被调函数的全部损失已经计入，包含时间 = 自身 + 子调用
+    struct Frame {
+        uint64_t function;
+        uint64_t caller;
+        uint64_t start;
+    };
+
+    // 把一个调用帧的时间计入调用边和被调函数
+    static void closeFrame(const Frame& frame, uint64_t end,
+                           std::map<std::pair<uint64_t, uint64_t>, CallEdge>& edges,
+                           std::unordered_map<uint64_t, uint64_t>& inclusive,
+                           std::unordered_map<uint64_t, uint64_t>& active);
+
+    std::unordered_map<uint64_t, PcCounters> counters_;
+    std::map<std::pair<uint64_t, uint64_t>, CallEdge> edges_;  // (调用者, 被调者)
+    std::unordered_map<uint64_t, uint64_t> inclusive_;         // 函数 -> 包含子调用的周期
+    std::unordered_map<uint64_t, uint64_t> active_;            // 函数 -> 栈上的帧数
+    std::vector<Frame> stack_;
+    uint64_t attributed_ = 0;  // 已归属到指令的周期总数
+    uint64_t entry_ = 0;
+    bool started_ = false;
+};
+
+#endif // PROFILE_H
@@ -1,3 +1,31 @@
 # python test.py --bin ./cpu
 # python test.py --bin "python cpu.py"
-# or customize your testing command
\ No newline at end of file
+# or customize your testing command
+
+# 各引擎和选项组合的退休状态序列都必须与答案一致
+for opts in "" "--engine=functional" "--engine=timing" "--engine=timing --issue-width=2" \
+            "--engine=timing --stages=F,F,D,E,M:2,W --alu-latency=3" "--engine=ooo" \
+            "--engine=ooo --issue-width=4 --rob=4 --rs=2 --lsq=2" "--predictor=2bit --ras=8" \
+            "--predictor=gshare --load-bypass" "--icache --dcache=write=through,penalty=3" \
+            "--mem-cap=64K"; do
+    echo "./cpu $opts: $(python3 test.py --bin "$(echo ./cpu $opts)" | tail -1)"
+done
+
+# 超出 --mem-cap：加载时超出报错并返回1，运行时超出按地址错误处理（STAT=3）
+cap_dir=$(mktemp -d)
+printf '0x000: 10 | nop\n0x001: 00 | halt\n0x2000: 0100000000000000 | .quad 1\n' > "$cap_dir/load.yo"
+printf '0x000: 30f00100000000000000 | irmovq $1,%%rax\n0x00a: 403f0020000000000000 | rmmovq %%rax,0x2000\n0x014: 00 | halt\n' > "$cap_dir/store.yo"
+for engine in pipeline functional timing ooo; do
+    ./cpu --engine=$engine --mem-cap=4K < "$cap_dir/load.yo" > /dev/null 2> "$cap_dir/err"
+    load_rc=$?
+    store=$(./cpu --engine=$engine --mem-cap=4K < "$cap_dir/store.yo" 2> /dev/null | python3 -c "
+import json, sys
+print([(s['PC'], s['STAT']) for s in json.load(sys.stdin)])")
+    if [ $load_rc -eq 1 ] && grep -q "^Error: Memory page limit exceeded" "$cap_dir/err" &&
+       [ "$store" = "[(10, 1), (18, 3)]" ]; then
+        echo "./cpu --engine=$engine --mem-cap=4K (over cap): All correct!"
+    else
+        echo "./cpu --engine=$engine --mem-cap=4K (over cap): load rc=$load_rc, states $store"
+    fi
+done
+rm -rf "$cap_dir"
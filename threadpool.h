@@ -0,0 +1,59 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池
+// 每个工作线程有自己的任务队列：从自己队列的尾部取任务，
+// 自己的队列空了就从其他线程队列的头部窃取，避免长任务把某个线程拖成瓶颈。
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // threads 为 0 时使用硬件线程数
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 提交任务（按轮转分配到各线程的队列）
+    void submit(Task task);
+    // 等待所有已提交的任务完成；任务抛出的第一个异常在这里重新抛出
+    void wait();
+
+    size_t size() const { return workers_.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+    // 先取自己队列的尾部，再从其他队列头部窃取
+    bool tryPop(size_t index, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;                  // 保护 pending_/stop_/error_，配合两个条件变量
+    std::condition_variable work_cv_;   // 有新任务或停止
+    std::condition_variable done_cv_;   // 所有任务完成
+    std::atomic<size_t> queued_{0};     // 还在队列中的任务数
+    size_t pending_ = 0;                // 已提交但未完成的任务数
+    size_t next_queue_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,388 @@
+#include "timing.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+RegUse regUse(uint8_t icode, uint8_t ifun, uint8_t rA, uint8_t rB) {
+    RegUse use;
+    switch (icode) {
+        case Y86::RRMOVQ:  // 包括CMOVXX
+            use.srcA = rA;
+            use.dstE = rB;
+            use.reads_cc = (ifun != 0);
+            break;
+        case Y86::IRMOVQ:
+            use.dstE = rB;
+            break;
+        case Y86::RMMOVQ:
+            use.srcA = rA;
+            use.srcB = rB;
+            break;
+        case Y86::MRMOVQ:
+            use.srcB = rB;
+            use.dstM = rA;
+            break;
+        case Y86::OPQ:
+            use.srcA = rA;
+            use.srcB = rB;
+            use.dstE = rB;
+            use.writes_cc = true;
+            break;
+        case Y86::JXX:
+            use.reads_cc = true;
+            break;
+        case Y86::CALL:
+            use.srcB = Y86::RSP;
+            use.dstE = Y86::RSP;
+            break;
+        case Y86::RET:
+            use.srcA = Y86::RSP;
+            use.srcB = Y86::RSP;
+            use.dstE = Y86::RSP;
+            break;
+        case Y86::PUSHQ:
+            use.srcA = rA;
+            use.srcB = Y86::RSP;
+            use.dstE = Y86::RSP;
+            break;
+        case Y86::POPQ:
+            use.srcA = Y86::RSP;
+            use.srcB = Y86::RSP;
+            use.dstE = Y86::RSP;
+            use.dstM = rA;
+            break;
+    }
+    return use;
+}
+
+namespace {
+
+const char STAGE_LETTERS[] = "FDEMW";
+
+// 一级的时间由若干约束中最晚的一个决定；同时满足时取第一个有原因的约束
+struct Constraint {
+    uint64_t cycle;
+    PipelineModel::Cause cause;
+};
+
+template <size_t N>
+Constraint latest(const Constraint (&candidates)[N]) {
+    Constraint best = candidates[0];
+    for (size_t i = 1; i < N; i++) {
+        const Constraint& c = candidates[i];
+        if (c.cycle > best.cycle ||
+            (c.cycle == best.cycle && best.cause == PipelineModel::OTHER)) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+// 占用数据端口的指令
+bool accessesMemory(uint8_t icode) {
+    return icode == Y86::RMMOVQ || icode == Y86::MRMOVQ || icode == Y86::PUSHQ ||
+           icode == Y86::POPQ || icode == Y86::CALL || icode == Y86::RET;
+}
+
+bool isControl(uint8_t icode) {
+    return icode == Y86::JXX || icode == Y86::CALL || icode == Y86::RET;
+}
+
+}  // namespace
+
+PipelineModel::Config::Config() {
+    parseStages("F,D,E,M,W");
+}
+
+void PipelineModel::Config::parseStages(const std::string& spec) {
+    std::vector<Stage> parsed;
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(pos, end - pos);
+        pos = end + 1;
+
+        const char* letter = item.empty() ? nullptr
+            : std::strchr(STAGE_LETTERS, std::toupper(static_cast<unsigned char>(item[0])));
+        if (!letter || *letter == '\0') {
+            throw std::runtime_error("invalid stage '" + item + "' in " + spec +
+                                     " (expected F, D, E, M or W)");
+        }
+        Stage stage{static_cast<StageKind>(letter - STAGE_LETTERS), 1};
+        if (item.size() > 1) {
+            size_t used = 0;
+            unsigned long value = 0;
+            try {
+                if (item[1] != ':') throw std::invalid_argument(item);
+                value = std::stoul(item.substr(2), &used);
+            } catch (const std::logic_error&) {
+                used = 0;
+            }
+            if (used == 0 || used != item.size() - 2 || value == 0 || value > 1000) {
+                throw std::runtime_error("invalid stage latency '" + item + "' in " + spec +
+                                         " (expected 1..1000)");
+            }
+            stage.latency = static_cast<unsigned>(value);
+        }
+        if (!parsed.empty() && stage.kind < parsed.back().kind) {
+            throw std::runtime_error("stages out of order in " + spec + " (expected F..D..E..M..W)");
+        }
+        parsed.push_back(stage);
+    }
+    for (int kind = FETCH; kind < NUM_KINDS; kind++) {
+        bool present = std::any_of(parsed.begin(), parsed.end(),
+                                   [&](const Stage& s) { return s.kind == kind; });
+        if (!present) {
+            throw std::runtime_error(std::string("missing ") + STAGE_LETTERS[kind] +
+                                     " stage in " + spec);
+        }
+    }
+    stages = std::move(parsed);
+}
+
+std::string PipelineModel::Config::describeStages() const {
+    std::string text;
+    for (const Stage& stage : stages) {
+        if (!text.empty()) text += ',';
+        text += STAGE_LETTERS[stage.kind];
+        if (stage.latency != 1) text += ':' + std::to_string(stage.latency);
+    }
+    return text;
+}
+
+const char* PipelineModel::causeName(Cause cause) {
+    switch (cause) {
+        case LOAD_USE: return "load_use";
+        case DATA: return "data";
+        case BRANCH: return "branch_mispredict";
+        case RET: return "ret";
+        case STRUCTURAL: return "structural";
+        case FETCH_BREAK: return "fetch_break";
+        case PAIRING: return "pairing";
+        default: return "other";
+    }
+}
+
+const char* PipelineModel::pairFailureName(PairFailure reason) {
+    switch (reason) {
+        case PAIR_FRONTEND: return "frontend";
+        case PAIR_DEPENDENCY: return "dependency";
+        case PAIR_EXECUTE: return "execute_busy";
+        case PAIR_MEMORY: return "memory_port";
+        default: return "control";
+    }
+}
+
+PipelineModel::PipelineModel(const Config& config)
+    : config_(config), ras_(config.ras_depth) {
+    const auto& stages = config_.stages;
+    for (size_t i = 0; i < stages.size(); i++) {
+        if (stages[i].kind == EXECUTE) {
+            if (stages[first_execute_].kind != EXECUTE) first_execute_ = i;
+            last_execute_ = i;
+        } else if (stages[i].kind == MEMORY) {
+            last_memory_ = i;
+        }
+    }
+    if (config_.width == 0) {
+        throw std::runtime_error("issue width must be at least 1");
+    }
+    predictor_ = makeBranchPredictor(config_.predictor);
+    if (!predictor_) {
+        throw std::runtime_error("unknown branch predictor " + config_.predictor);
+    }
+    reset();
+}
+
+void PipelineModel::reset() {
+    predictor_->reset();
+    ras_.reset();
+    pending_updates_.clear();
+    slot_free_.assign(config_.width, std::vector<Timing>(config_.stages.size(), Timing{0, OTHER}));
+    prev_.assign(config_.stages.size(), Timing{0, OTHER});
+    cur_.assign(config_.stages.size(), Timing{0, OTHER});
+    seq_ = 0;
+    bundle_cycle_ = 0;
+    bundle_size_ = 0;
+    bundle_memory_ = false;
+    bundle_control_ = false;
+    fetch_break_ = false;
+    std::fill(std::begin(reg_ready_), std::end(reg_ready_), 0);
+    std::fill(std::begin(reg_from_load_), std::end(reg_from_load_), false);
+    cc_ready_ = 0;
+    fetch_ready_ = 1;
+    fetch_cause_ = OTHER;
+    last_complete_ = 0;
+    last_completions_ = 0;
+    stats_ = Stats();
+    stats_.width = config_.width;
+    stats_.bundle_sizes.assign(config_.width + 1, 0);
+}
+
+unsigned PipelineModel::latency(size_t stage, const RetiredInst& inst) const {
+    if (stage == last_execute_ && inst.icode == Y86::OPQ && config_.alu_latency > 0) {
+        return config_.alu_latency;
+    }
+    return config_.stages[stage].latency;
+}
+
+void PipelineModel::issue(const RetiredInst& inst) {
+    const size_t n = config_.stages.size();
+    const unsigned width = config_.width;
+    std::vector<Timing>& slot = slot_free_[seq_++ % width];
+
+    // 取指时被丢弃的非法指令只占用第一级的一个槽位
+    if (inst.stat == Y86::STAT_INS) {
+        uint64_t fetch = std::max({fetch_ready_, slot[0].enter, prev_[0].enter});
+        slot[0] = {fetch + latency(0, inst), OTHER};
+        prev_[0] = {fetch, OTHER};
+        return;
+    }
+
+    RegUse use = regUse(inst.icode, inst.ifun, inst.rA, inst.rB);
+    bool memory = accessesMemory(inst.icode);
+    bool control = isControl(inst.icode);
+
+    // 操作数就绪：第一个E级开始时需要所有源寄存器和条件码
+    Constraint operands{0, OTHER};
+    for (uint8_t src : {use.srcA, use.srcB}) {
+        if (src != Y86::RNONE && reg_ready_[src] > operands.cycle) {
+            operands = {reg_ready_[src], reg_from_load_[src] ? LOAD_USE : DATA};
+        }
+    }
+    if (use.reads_cc && cc_ready_ > operands.cycle) {
+        operands = {cc_ready_, DATA};
+    }
+
+    // 逐级计算进入时间：上一级完成、本级有空槽位、不早于上一条指令进入本级、E级的操作数就绪
+    // （单发射时槽位约束总是晚于顺序约束，结果与一级只容纳一条指令相同）
+    for (size_t s = 0; s < n; s++) {
+        Constraint in_order{prev_[s].enter, prev_[s].cause};
+        Constraint free{slot[s].enter, slot[s].cause};
+        Constraint result;
+        if (s == 0) {
+            Constraint group_end{width > 1 && fetch_break_ ? prev_[0].enter + 1 : 0, FETCH_BREAK};
+            Constraint candidates[] = {{fetch_ready_, fetch_cause_}, free, in_order, group_end};
+            result = latest(candidates);
+        } else {
+            Constraint arrival{cur_[s - 1].enter + latency(s - 1, inst), cur_[s - 1].cause};
+            if (s == first_execute_) {
+                Constraint candidates[] = {operands, arrival, free, in_order};
+                result = latest(candidates);
+                if (width > 1) {
+                    // 与前一条指令同周期进入时加入它所在的组，否则开始新的一组
+                    bool first = (stats_.instructions == 0);
+                    bool joins = !first && result.cycle == bundle_cycle_;
+                    if (joins && ((memory && bundle_memory_) || (control && bundle_control_))) {
+                        result = {result.cycle + 1, PAIRING};
+                        joins = false;
+                    }
+                    if (!joins && !first && bundle_size_ < width) {
+                        PairFailure reason = PAIR_CONTROL;
+                        if (arrival.cycle > bundle_cycle_) {
+                            reason = PAIR_FRONTEND;
+                        } else if (operands.cycle > bundle_cycle_) {
+                            reason = PAIR_DEPENDENCY;
+                        } else if (free.cycle > bundle_cycle_) {
+                            reason = PAIR_EXECUTE;
+                        } else if (memory && bundle_memory_) {
+                            reason = PAIR_MEMORY;
+                        }
+                        stats_.pair_failures[reason]++;
+                    }
+                    if (joins) {
+                        stats_.bundle_sizes[bundle_size_]--;
+                        bundle_memory_ |= memory;
+                        bundle_control_ |= control;
+                    } else {
+                        bundle_cycle_ = result.cycle;
+                        bundle_size_ = 0;
+                        bundle_memory_ = memory;
+                        bundle_control_ = control;
+                    }
+                    stats_.bundle_sizes[++bundle_size_]++;
+                }
+            } else {
+                Constraint candidates[] = {arrival, free, in_order};
+                result = latest(candidates);
+            }
+        }
+        cur_[s] = {result.cycle, result.cause};
+    }
+
+    // 后面的指令被多周期的级挡住时，额外周期算作结构冒险；顺序流水线中指令按顺序完成
+    uint64_t complete = std::max(cur_[n - 1].enter + latency(n - 1, inst) - 1, last_complete_);
+    for (size_t s = 0; s < n; s++) {
+        uint64_t leave = (s + 1 < n) ? cur_[s + 1].enter : complete + 1;
+        Cause cause = (s + 1 < n) ? cur_[s + 1].cause : cur_[s].cause;
+        slot[s] = {leave, latency(s, inst) > 1 ? STRUCTURAL : cause};
+    }
+    prev_ = cur_;
+
+    // 结果就绪时间（dstM 晚于 dstE 写回，popq %rsp 得到加载的值）
+    uint64_t execute_done = cur_[last_execute_].enter + latency(last_execute_, inst);
+    uint64_t memory_done = cur_[last_memory_].enter + latency(last_memory_, inst);
+    if (use.dstE != Y86::RNONE) {
+        reg_ready_[use.dstE] = execute_done;
+        reg_from_load_[use.dstE] = false;
+    }
+    if (use.dstM != Y86::RNONE) {
+        reg_ready_[use.dstM] = memory_done - (config_.load_bypass ? 1 : 0);
+        reg_from_load_[use.dstM] = true;
+    }
+    if (use.writes_cc) {
+        cc_ready_ = execute_done;
+    }
+
+    // 控制流：预测器在取指时预测、在执行阶段确定方向的周期更新
+    uint64_t fetch = cur_[0].enter;
+    fetch_ready_ = 0;
+    fetch_cause_ = OTHER;
+    fetch_break_ = (inst.icode == Y86::CALL || inst.icode == Y86::RET);
+    if (inst.icode == Y86::JXX) {
+        while (!pending_updates_.empty() && pending_updates_.front().cycle <= fetch) {
+            const PendingUpdate& update = pending_updates_.front();
+            predictor_->update(update.pc, update.target, update.taken);
+            pending_updates_.pop_front();
+        }
+        bool predicted = predictor_->predict(inst.pc, inst.valC, inst.ifun == Y86::C_YES);
+        pending_updates_.push_back({execute_done - 1, inst.pc, inst.valC, inst.taken});
+        stats_.branches++;
+        fetch_break_ = predicted;
+        if (predicted != inst.taken) {
+            stats_.branch_mispredicts++;
+            fetch_ready_ = execute_done;
+            fetch_cause_ = BRANCH;
+        }
+    } else if (inst.icode == Y86::CALL) {
+        ras_.push(inst.valP);
+    } else if (inst.icode == Y86::RET) {
+        uint64_t target = 0;
+        if (ras_.pop(target) && target == inst.next_pc) {
+            stats_.ras_hits++;
+        } else {
+            if (ras_.enabled()) stats_.ras_misses++;
+            fetch_ready_ = memory_done;
+            fetch_cause_ = RET;
+        }
+    }
+
+    // 空闲的退休槽位归到决定完成时间的原因上：上一条指令完成的周期剩下的槽位，
+    // 加上中间完全空闲的周期
+    if (stats_.instructions == 0) {
+        stats_.fill_cycles = complete - 1;
+        last_completions_ = 1;
+    } else if (complete == last_complete_) {
+        last_completions_++;
+    } else {
+        uint64_t idle = (width - last_completions_) + width * (complete - last_complete_ - 1);
+        stats_.cause_slots[cur_[n - 1].cause] += idle;
+        last_completions_ = 1;
+    }
+    stats_.tail_slots = width - last_completions_;
+    stats_.instructions++;
+    stats_.cycles = complete;
+    last_complete_ = complete;
+}
@@ -0,0 +1,166 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "functional.h"
+#include "branch_predictor.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 指令读写的寄存器和条件码（与流水线译码阶段的 srcA/srcB/dstE/dstM 规则一致）
+struct RegUse {
+    uint8_t srcA = Y86::RNONE;
+    uint8_t srcB = Y86::RNONE;
+    uint8_t dstE = Y86::RNONE;
+    uint8_t dstM = Y86::RNONE;
+    bool reads_cc = false;   // JXX、CMOVXX
+    bool writes_cc = false;  // OPQ
+};
+RegUse regUse(uint8_t icode, uint8_t ifun, uint8_t rA, uint8_t rB);
+
+// 可配置深度的顺序流水线时序模型
+//
+// 由功能级模拟器按程序顺序驱动（FunctionalSimulator::setInstSink），只计算每条指令
+// 进入各级的周期，不改变体系结构状态，所以退休状态序列与其他引擎完全相同。
+// 流水线由若干级组成，每级属于 F/D/E/M/W 之一（同一类可以有多级，例如两级取指），
+// 并有各自的延迟（占用周期数，延迟大于1的级不是流水化的）。冒险由各值的就绪时间统一处理：
+//   - 操作数（寄存器和条件码）在第一个E级开始时需要；运算结果在最后一个E级结束时、
+//     加载结果在最后一个M级结束时就绪，并立即转发给后续指令
+//   - JXX 在最后一个E级结束时确定方向，RET 在最后一个M级结束时得到返回地址，
+//     预测失败时下一条指令从下一个周期开始取指
+//   - 一级中最多同时有 width 条指令，后面的指令被阻塞在前一级
+// 默认配置 F,D,E,M,W（单发射）与 PipelineSimulator 的周期数一致。
+//
+// width 大于 1 时为多发射的顺序流水线：每级有 width 个槽位，同一周期进入第一个E级的
+// 相邻指令组成一组（bundle）。组内的指令之间通过就绪时间检查相关（同组的后一条指令
+// 不能使用前一条的结果，转发只在组之间进行），此外每组最多一条访存指令（一个数据端口）
+// 和一条控制转移指令；取指组在被预测跳转的控制转移指令之后结束。
+class PipelineModel {
+public:
+    // 流水线级的类别（按流水线中的先后顺序）
+    enum StageKind : uint8_t { FETCH, DECODE, EXECUTE, MEMORY, WRITEBACK, NUM_KINDS };
+
+    struct Stage {
+        StageKind kind;
+        unsigned latency;
+    };
+
+    struct Config {
+        std::vector<Stage> stages;
+        unsigned alu_latency = 0;     // OPQ 在最后一个E级的延迟，0 表示使用该级的延迟
+        std::string predictor = "nt";
+        size_t ras_depth = 0;
+        bool load_bypass = false;     // 加载结果在最后一个M级的最后一个周期就转发给E级
+        unsigned width = 1;           // 发射宽度：每级的槽位数
+
+        Config();  // 五级流水线 F,D,E,M,W
+        // 解析级配置，例如 "F,F,D,E,M:2,W"（类别字母，可选 ":延迟"），格式错误时抛出 std::runtime_error
+        void parseStages(const std::string& spec);
+        std::string describeStages() const;
+    };
+
+    // 额外周期（单发射时 CPI 超过 1 的部分；多发射时为空闲的退休槽位）的原因
+    enum Cause : uint8_t {
+        OTHER,        // 没有可归属的原因（例如被跳过的非法指令占用的取指周期）
+        LOAD_USE,     // 等待加载结果
+        DATA,         // 等待其他指令的运算结果或条件码（多周期运算）
+        BRANCH,       // JXX 预测失败
+        RET,          // RET 返回地址预测失败或无法预测
+        STRUCTURAL,   // 多周期的级被占用
+        FETCH_BREAK,  // 取指组在跳转处结束（仅多发射）
+        PAIRING,      // 访存或控制转移指令不能与同组指令配对（仅多发射）
+        NUM_CAUSES
+    };
+    static const char* causeName(Cause cause);
+
+    // 多发射时一条指令没能进入前一条指令所在的、还有空槽位的组的原因
+    enum PairFailure : uint8_t {
+        PAIR_FRONTEND,    // 还没有到达E级（取指组结束、控制冒险、前端阻塞）
+        PAIR_DEPENDENCY,  // 操作数未就绪（包括依赖同组的指令）
+        PAIR_EXECUTE,     // E级的槽位还被多周期的指令占用
+        PAIR_MEMORY,      // 组内已有访存指令
+        PAIR_CONTROL,     // 组内已有控制转移指令
+        NUM_PAIR_FAILURES
+    };
+    static const char* pairFailureName(PairFailure reason);
+
+    struct Stats {
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        unsigned width = 1;
+        uint64_t fill_cycles = 0;             // 第一条指令完成之前的周期
+        // 第一条指令完成之后空闲的退休槽位（每周期 width 个），按原因归属；
+        // 最后一个周期剩下的槽位记在 tail_slots。单发射时即额外周期数
+        uint64_t cause_slots[NUM_CAUSES] = {};
+        uint64_t tail_slots = 0;
+        std::vector<uint64_t> bundle_sizes;   // [k]：有 k 条指令的组数（k = 1..width）
+        uint64_t pair_failures[NUM_PAIR_FAILURES] = {};
+        uint64_t branches = 0;
+        uint64_t branch_mispredicts = 0;
+        uint64_t ras_hits = 0;
+        uint64_t ras_misses = 0;
+        double cpi() const {
+            return instructions ? static_cast<double>(cycles) / instructions : 0.0;
+        }
+    };
+
+    explicit PipelineModel(const Config& config);
+
+    void reset();
+    // 按程序顺序送入一条执行完的指令
+    void issue(const RetiredInst& inst);
+    const Stats& stats() const { return stats_; }
+    const Config& config() const { return config_; }
+
+private:
+    // 一条指令在某一级的时间由哪一类约束决定（用于把额外周期归到原因上）
+    struct Timing {
+        uint64_t enter;  // 进入该级的周期
+        Cause cause;     // 决定 enter 的原因链最终指向的原因（无额外延迟时为 OTHER）
+    };
+    struct PendingUpdate {
+        uint64_t cycle;  // 执行阶段确定方向的周期，之后取指的分支才能看到这次更新
+        uint64_t pc;
+        uint64_t target;
+        bool taken;
+    };
+
+    unsigned latency(size_t stage, const RetiredInst& inst) const;
+
+    Config config_;
+    size_t first_execute_ = 0;
+    size_t last_execute_ = 0;
+    size_t last_memory_ = 0;
+
+    std::unique_ptr<BranchPredictor> predictor_;
+    ReturnAddressStack ras_;
+    std::deque<PendingUpdate> pending_updates_;
+
+    // 各槽位空出来的周期（width 条之前的指令离开该级的周期）及其原因，按指令序号轮流使用；
+    // prev_ 为上一条指令（顺序流水线中后面的指令不能先进入同一级），cur_ 为正在计算的指令
+    std::vector<std::vector<Timing>> slot_free_;
+    std::vector<Timing> prev_;
+    std::vector<Timing> cur_;
+    uint64_t seq_ = 0;
+    // 最近一组（进入第一个E级的周期相同的指令）
+    uint64_t bundle_cycle_ = 0;
+    unsigned bundle_size_ = 0;
+    bool bundle_memory_ = false;
+    bool bundle_control_ = false;
+    bool fetch_break_ = false;  // 上一条指令是被预测跳转的控制转移指令
+    // 寄存器和条件码的就绪周期（从该周期起可以进入E级），以及由谁产生
+    uint64_t reg_ready_[16] = {};
+    bool reg_from_load_[16] = {};
+    uint64_t cc_ready_ = 0;
+    // 下一条指令最早的取指周期（控制冒险）及原因
+    uint64_t fetch_ready_ = 1;
+    Cause fetch_cause_ = OTHER;
+    uint64_t last_complete_ = 0;
+    unsigned last_completions_ = 0;  // last_complete_ 周期完成的指令数
+
+    Stats stats_;
+};
+
+#endif // TIMING_H
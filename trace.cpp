@@ -0,0 +1,131 @@
+#include "trace.h"
+#include <stdexcept>
+#include <string>
+
+TraceLog::TraceLog(size_t checkpoint_interval)
+    : interval_(checkpoint_interval > 0 ? checkpoint_interval : 1) {
+}
+
+void TraceLog::clear() {
+    entries_.clear();
+    reg_deltas_.clear();
+    mem_deltas_.clear();
+    checkpoints_.clear();
+    count_ = 0;
+    current_ = ArchState();
+    last_mem_.clear();
+    last_full_ = false;
+}
+
+void TraceLog::append(uint64_t pc, const RegisterFile& regs, const Memory& mem,
+                      const ConditionCodes& cc, uint8_t stat) {
+    Entry entry;
+    entry.PC = pc;
+    entry.reg_begin = reg_deltas_.size();
+    entry.mem_begin = mem_deltas_.size();
+    entry.CC = cc;
+    entry.STAT = stat;
+    last_mem_.clear();
+    last_full_ = false;
+
+    if (count_ == 0 || (retain_ && isCheckpoint(entries_.size()))) {
+        // 检查点：直接保存完整状态，不记录增量
+        current_.PC = pc;
+        current_.regs = regs;
+        current_.mem_snapshot = mem.getNonZeroMemory();
+        current_.CC = cc;
+        current_.STAT = stat;
+        count_++;
+        last_full_ = true;
+        if (retain_) {
+            checkpoints_.push_back(current_);
+            entries_.push_back(entry);
+        }
+        return;
+    }
+
+    // 寄存器增量
+    for (uint8_t i = 0; i < 15; i++) {
+        if (regs.regs[i] != current_.regs.regs[i]) {
+            if (retain_) reg_deltas_.push_back({i, regs.regs[i]});
+            current_.regs.regs[i] = regs.regs[i];
+        }
+    }
+
+    // 内存增量：只检查自上次退休以来被写过的字
+    const auto& nonzero = mem.getNonZeroMemory();
+    for (uint64_t addr : mem.getDirtyWords()) {
+        auto it = nonzero.find(addr);
+        int64_t val = (it != nonzero.end()) ? it->second : 0;
+        auto cur = current_.mem_snapshot.find(addr);
+        int64_t old_val = (cur != current_.mem_snapshot.end()) ? cur->second : 0;
+        if (val == old_val) continue;
+        last_mem_.push_back({addr, val});
+        if (retain_) mem_deltas_.push_back({addr, val});
+        if (val != 0) {
+            current_.mem_snapshot[addr] = val;
+        } else {
+            current_.mem_snapshot.erase(cur);
+        }
+    }
+
+    current_.PC = pc;
+    current_.CC = cc;
+    current_.STAT = stat;
+    count_++;
+    if (retain_) entries_.push_back(entry);
+}
+
+void TraceLog::applyEntry(size_t index, ArchState& state) const {
+    const Entry& entry = entries_[index];
+    size_t reg_end = (index + 1 < entries_.size()) ? entries_[index + 1].reg_begin
+                                                    : reg_deltas_.size();
+    size_t mem_end = (index + 1 < entries_.size()) ? entries_[index + 1].mem_begin
+                                                    : mem_deltas_.size();
+    for (size_t i = entry.reg_begin; i < reg_end; i++) {
+        state.regs.regs[reg_deltas_[i].reg] = reg_deltas_[i].val;
+    }
+    for (size_t i = entry.mem_begin; i < mem_end; i++) {
+        if (mem_deltas_[i].val != 0) {
+            state.mem_snapshot[mem_deltas_[i].addr] = mem_deltas_[i].val;
+        } else {
+            state.mem_snapshot.erase(mem_deltas_[i].addr);
+        }
+    }
+    state.PC = entry.PC;
+    state.CC = entry.CC;
+    state.STAT = entry.STAT;
+}
+
+ArchState TraceLog::at(size_t index) const {
+    if (index + 1 == count_) return current_;
+    if (!retain_ || index >= entries_.size()) {
+        throw std::out_of_range("trace entry " + std::to_string(index) + " is not retained");
+    }
+    size_t base = index / interval_;
+    ArchState state = checkpoints_[base];
+    for (size_t i = base * interval_ + 1; i <= index; i++) {
+        applyEntry(i, state);
+    }
+    return state;
+}
+
+// const_iterator 实现
+TraceLog::const_iterator::const_iterator(const TraceLog* log, size_t index)
+    : log_(log), index_(index) {
+    if (index_ < log_->entries_.size()) {
+        state_ = log_->at(index_);
+    }
+}
+
+TraceLog::const_iterator& TraceLog::const_iterator::operator++() {
+    index_++;
+    if (index_ < log_->entries_.size()) {
+        if (log_->isCheckpoint(index_)) {
+            state_ = log_->checkpoints_[index_ / log_->interval_];
+        } else {
+            log_->applyEntry(index_, state_);
+        }
+    }
+    return *this;
+}
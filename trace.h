@@ -0,0 +1,115 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "y86.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <vector>
+
+// 一条指令退休后的体系结构状态（用于输出JSON）
+struct ArchState {
+    uint64_t PC = 0;
+    RegisterFile regs;
+    std::map<uint64_t, int64_t> mem_snapshot;  // 当时的非零内存值快照
+    ConditionCodes CC;
+    uint8_t STAT = Y86::STAT_AOK;
+};
+
+// 退休状态日志（增量编码）
+// 每条记录只保存相对上一状态变化的寄存器、内存字以及PC/CC/STAT，
+// 每隔 checkpoint_interval 条保存一次完整检查点，任意状态都可以按需重建。
+class TraceLog {
+public:
+    struct RegDelta {
+        uint8_t reg;
+        int64_t val;
+    };
+    struct MemDelta {
+        uint64_t addr;
+        int64_t val;   // 0 表示该字变回零（从快照中删除）
+    };
+
+    static constexpr size_t DEFAULT_CHECKPOINT_INTERVAL = 1024;
+
+    explicit TraceLog(size_t checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL);
+
+    void clear();
+
+    // 是否保留历史记录；关闭后只维护最后一个状态（流式输出时内存占用不随指令数增长）
+    void setRetain(bool retain) { retain_ = retain; }
+    bool retaining() const { return retain_; }
+
+    // 追加一条退休记录；内存变化取自 mem.getDirtyWords()，调用者负责随后清除脏字
+    void append(uint64_t pc, const RegisterFile& regs, const Memory& mem,
+                const ConditionCodes& cc, uint8_t stat);
+
+    // 已追加的记录数（不保留历史时也计数）
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    // 最后一条记录对应的完整状态
+    const ArchState& back() const { return current_; }
+    // 最后一条记录相对上一条的内存变化（不保留历史时也维护，用于流式输出增量）；
+    // lastWasFull() 为 true 时最后一条是完整快照，没有增量
+    const std::vector<MemDelta>& lastMemDeltas() const { return last_mem_; }
+    bool lastWasFull() const { return last_full_; }
+    // 从最近的检查点重建第 index 条记录的状态；最后一条总是可用，
+    // 其余记录要求保留历史，不可用时抛出 std::out_of_range
+    ArchState at(size_t index) const;
+
+    // 顺序迭代器：逐条应用增量，每步代价与该条记录的变化量成正比
+    // （只遍历保留下来的记录）
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = ArchState;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ArchState*;
+        using reference = const ArchState&;
+
+        const_iterator() = default;
+        reference operator*() const { return state_; }
+        pointer operator->() const { return &state_; }
+        const_iterator& operator++();
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        friend class TraceLog;
+        const_iterator(const TraceLog* log, size_t index);
+
+        const TraceLog* log_ = nullptr;
+        size_t index_ = 0;
+        ArchState state_;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, entries_.size()); }
+
+private:
+    struct Entry {
+        uint64_t PC;
+        size_t reg_begin;    // 在 reg_deltas_ 中的起始下标
+        size_t mem_begin;    // 在 mem_deltas_ 中的起始下标
+        ConditionCodes CC;
+        uint8_t STAT;
+    };
+
+    bool isCheckpoint(size_t index) const { return index % interval_ == 0; }
+    // 在 state 上应用第 index 条记录的增量
+    void applyEntry(size_t index, ArchState& state) const;
+
+    size_t interval_;
+    bool retain_ = true;
+    size_t count_ = 0;
+    std::vector<Entry> entries_;
+    std::vector<RegDelta> reg_deltas_;
+    std::vector<MemDelta> mem_deltas_;
+    std::vector<ArchState> checkpoints_;  // 第 k 个检查点对应第 k*interval_ 条记录
+    ArchState current_;
+    std::vector<MemDelta> last_mem_;
+    bool last_full_ = false;
+};
+
+#endif // TRACE_H
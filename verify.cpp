@@ -0,0 +1,340 @@
+#include "verify.h"
+#include <sstream>
+#include <stdexcept>
+
+JsonStateReader::JsonStateReader(FILE* in) : in_(in), buf_(BUFFER_SIZE) {
+}
+
+int JsonStateReader::peek() {
+    if (pos_ == len_) {
+        len_ = std::fread(buf_.data(), 1, buf_.size(), in_);
+        pos_ = 0;
+        if (len_ == 0) return EOF;
+    }
+    return static_cast<unsigned char>(buf_[pos_]);
+}
+
+int JsonStateReader::get() {
+    int c = peek();
+    if (c != EOF) {
+        pos_++;
+        offset_++;
+    }
+    return c;
+}
+
+void JsonStateReader::skipSpace() {
+    while (true) {
+        int c = peek();
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return;
+        get();
+    }
+}
+
+void JsonStateReader::error(const std::string& what) {
+    throw std::runtime_error("Malformed answer JSON at byte " + std::to_string(offset_) + ": " + what);
+}
+
+void JsonStateReader::expect(char c) {
+    skipSpace();
+    if (get() != c) {
+        error(std::string("expected '") + c + "'");
+    }
+}
+
+std::string JsonStateReader::parseString() {
+    expect('"');
+    std::string out;
+    while (true) {
+        int c = get();
+        if (c == EOF) error("unterminated string");
+        if (c == '"') return out;
+        if (c == '\\') {
+            c = get();
+            if (c == EOF) error("unterminated string");
+        }
+        out += static_cast<char>(c);
+    }
+}
+
+int64_t JsonStateReader::parseInt() {
+    skipSpace();
+    bool negative = false;
+    if (peek() == '-') {
+        negative = true;
+        get();
+    }
+    if (peek() < '0' || peek() > '9') {
+        error("expected integer");
+    }
+    uint64_t val = 0;
+    while (peek() >= '0' && peek() <= '9') {
+        val = val * 10 + static_cast<uint64_t>(get() - '0');
+    }
+    // 与 JSON 中的有符号64位整数对应（按补码回绕）
+    return static_cast<int64_t>(negative ? 0 - val : val);
+}
+
+// 跳过不认识的字段值（任意JSON值）
+void JsonStateReader::skipValue() {
+    skipSpace();
+    int c = peek();
+    if (c == '"') {
+        parseString();
+    } else if (c == '{' || c == '[') {
+        char close = (c == '{') ? '}' : ']';
+        get();
+        skipSpace();
+        if (peek() == close) {
+            get();
+            return;
+        }
+        while (true) {
+            if (close == '}') {
+                parseString();
+                expect(':');
+            }
+            skipValue();
+            skipSpace();
+            int next = get();
+            if (next == close) return;
+            if (next != ',') error("expected ',' or closing bracket");
+        }
+    } else if (c == EOF) {
+        error("unexpected end of input");
+    } else {
+        // 数字、true/false/null
+        while (true) {
+            c = peek();
+            if (c == EOF || c == ',' || c == '}' || c == ']' || c == ' ' ||
+                c == '\t' || c == '\n' || c == '\r') {
+                return;
+            }
+            get();
+        }
+    }
+}
+
+bool JsonStateReader::next(ArchState& state) {
+    if (finished_) return false;
+    skipSpace();
+    if (!started_) {
+        expect('[');
+        started_ = true;
+        skipSpace();
+        if (peek() == ']') {
+            get();
+            finished_ = true;
+            return false;
+        }
+    } else {
+        int c = get();
+        if (c == ']') {
+            finished_ = true;
+            return false;
+        }
+        if (c != ',') error("expected ',' or ']'");
+    }
+    state = ArchState();
+    parseState(state);
+    return true;
+}
+
+void JsonStateReader::parseState(ArchState& state) {
+    expect('{');
+    skipSpace();
+    if (peek() == '}') {
+        get();
+        return;
+    }
+    while (true) {
+        std::string key = parseString();
+        expect(':');
+        if (key == "PC") {
+            state.PC = static_cast<uint64_t>(parseInt());
+        } else if (key == "REG") {
+            parseRegs(state.regs);
+        } else if (key == "MEM") {
+            parseMem(state.mem_snapshot);
+        } else if (key == "CC") {
+            parseCC(state.CC);
+        } else if (key == "STAT") {
+            state.STAT = static_cast<uint8_t>(parseInt());
+        } else {
+            skipValue();
+        }
+        skipSpace();
+        int c = get();
+        if (c == '}') return;
+        if (c != ',') error("expected ',' or '}'");
+    }
+}
+
+void JsonStateReader::parseRegs(RegisterFile& regs) {
+    expect('{');
+    skipSpace();
+    if (peek() == '}') {
+        get();
+        return;
+    }
+    while (true) {
+        std::string name = parseString();
+        expect(':');
+        int64_t val = parseInt();
+        bool found = false;
+        for (uint8_t i = 0; i < 15; i++) {
+            if (Y86::getRegName(i) == name) {
+                regs.set(i, val);
+                found = true;
+                break;
+            }
+        }
+        if (!found) error("unknown register " + name);
+        skipSpace();
+        int c = get();
+        if (c == '}') return;
+        if (c != ',') error("expected ',' or '}'");
+    }
+}
+
+void JsonStateReader::parseMem(std::map<uint64_t, int64_t>& mem) {
+    expect('{');
+    skipSpace();
+    if (peek() == '}') {
+        get();
+        return;
+    }
+    while (true) {
+        std::string key = parseString();
+        uint64_t addr = 0;
+        if (key.empty()) error("empty memory address");
+        for (char ch : key) {
+            if (ch < '0' || ch > '9') error("bad memory address " + key);
+            addr = addr * 10 + static_cast<uint64_t>(ch - '0');
+        }
+        expect(':');
+        int64_t val = parseInt();
+        if (val != 0) {
+            mem[addr] = val;
+        }
+        skipSpace();
+        int c = get();
+        if (c == '}') return;
+        if (c != ',') error("expected ',' or '}'");
+    }
+}
+
+void JsonStateReader::parseCC(ConditionCodes& cc) {
+    expect('{');
+    skipSpace();
+    if (peek() == '}') {
+        get();
+        return;
+    }
+    while (true) {
+        std::string flag = parseString();
+        expect(':');
+        bool val = parseInt() != 0;
+        if (flag == "ZF") cc.ZF = val;
+        else if (flag == "SF") cc.SF = val;
+        else if (flag == "OF") cc.OF = val;
+        else error("unknown condition code " + flag);
+        skipSpace();
+        int c = get();
+        if (c == '}') return;
+        if (c != ',') error("expected ',' or '}'");
+    }
+}
+
+// TraceVerifier 实现
+TraceVerifier::TraceVerifier(FILE* expected) : reader_(expected) {
+}
+
+bool TraceVerifier::fail(const std::string& what) {
+    failed_ = true;
+    message_ = what;
+    return false;
+}
+
+bool TraceVerifier::check(const ArchState& actual) {
+    if (failed_) return false;
+    size_t index = compared_;
+    try {
+        if (!reader_.next(expected_)) {
+            return fail("State " + std::to_string(index) + ": answer ends here, simulator produced more states");
+        }
+    } catch (const std::runtime_error& e) {
+        return fail(e.what());
+    }
+
+    std::ostringstream out;
+    out << "State " << index << " (PC " << actual.PC << "): ";
+    if (actual.PC != expected_.PC) {
+        out << "PC expected " << expected_.PC << ", got " << actual.PC;
+        return fail(out.str());
+    }
+    for (uint8_t i = 0; i < 15; i++) {
+        if (actual.regs.get(i) != expected_.regs.get(i)) {
+            out << "REG " << Y86::getRegName(i) << " expected " << expected_.regs.get(i)
+                << ", got " << actual.regs.get(i);
+            return fail(out.str());
+        }
+    }
+    // 两个有序的非零内存表归并比较，报告第一个不同的地址
+    auto a = actual.mem_snapshot.begin();
+    auto e = expected_.mem_snapshot.begin();
+    while (a != actual.mem_snapshot.end() || e != expected_.mem_snapshot.end()) {
+        uint64_t addr;
+        int64_t got = 0;
+        int64_t want = 0;
+        if (e == expected_.mem_snapshot.end() ||
+            (a != actual.mem_snapshot.end() && a->first < e->first)) {
+            addr = a->first;
+            got = a->second;
+            ++a;
+        } else if (a == actual.mem_snapshot.end() || e->first < a->first) {
+            addr = e->first;
+            want = e->second;
+            ++e;
+        } else {
+            addr = a->first;
+            got = a->second;
+            want = e->second;
+            ++a;
+            ++e;
+        }
+        if (got != want) {
+            out << "MEM[" << addr << "] expected " << want << ", got " << got;
+            return fail(out.str());
+        }
+    }
+    const char* names[3] = {"ZF", "SF", "OF"};
+    bool got_cc[3] = {actual.CC.ZF, actual.CC.SF, actual.CC.OF};
+    bool want_cc[3] = {expected_.CC.ZF, expected_.CC.SF, expected_.CC.OF};
+    for (int i = 0; i < 3; i++) {
+        if (got_cc[i] != want_cc[i]) {
+            out << "CC " << names[i] << " expected " << want_cc[i] << ", got " << got_cc[i];
+            return fail(out.str());
+        }
+    }
+    if (actual.STAT != expected_.STAT) {
+        out << "STAT expected " << static_cast<int>(expected_.STAT) << ", got "
+            << static_cast<int>(actual.STAT);
+        return fail(out.str());
+    }
+    compared_++;
+    return true;
+}
+
+bool TraceVerifier::finish() {
+    if (failed_) return false;
+    try {
+        if (reader_.next(expected_)) {
+            return fail("State " + std::to_string(compared_) +
+                        ": simulator stopped here, answer has more states");
+        }
+    } catch (const std::runtime_error& e) {
+        return fail(e.what());
+    }
+    return true;
+}
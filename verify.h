@@ -0,0 +1,69 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "trace.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// 期望答案（answer/*.json 格式）的流式读取器
+// 每次只解析数组中的一个状态对象，内存占用与答案长度无关。
+class JsonStateReader {
+public:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    explicit JsonStateReader(FILE* in);
+
+    // 读取下一个状态；数组已结束时返回 false。格式错误时抛出 std::runtime_error
+    bool next(ArchState& state);
+
+private:
+    int peek();
+    int get();
+    void skipSpace();
+    void expect(char c);
+    std::string parseString();
+    int64_t parseInt();
+    void skipValue();
+    [[noreturn]] void error(const std::string& what);
+
+    void parseState(ArchState& state);
+    void parseRegs(RegisterFile& regs);
+    void parseMem(std::map<uint64_t, int64_t>& mem);
+    void parseCC(ConditionCodes& cc);
+
+    FILE* in_;
+    std::vector<char> buf_;
+    size_t pos_ = 0;
+    size_t len_ = 0;
+    uint64_t offset_ = 0;    // 已读取的字节数（用于错误信息）
+    bool started_ = false;   // 已读到数组开头 '['
+    bool finished_ = false;  // 已读到数组结尾 ']'
+};
+
+// 将模拟器的退休状态与期望答案逐个比较
+// 在状态回调里调用 check()，发现第一个不一致就停止，不保存任何一方的完整序列。
+class TraceVerifier {
+public:
+    explicit TraceVerifier(FILE* expected);
+
+    // 比较下一个实际状态；不一致时返回 false，message() 给出差异
+    bool check(const ArchState& actual);
+    // 模拟结束后调用：检查期望序列是否也恰好结束
+    bool finish();
+
+    bool failed() const { return failed_; }
+    const std::string& message() const { return message_; }
+    size_t compared() const { return compared_; }
+
+private:
+    bool fail(const std::string& what);
+
+    JsonStateReader reader_;
+    ArchState expected_;
+    size_t compared_ = 0;
+    bool failed_ = false;
+    std::string message_;
+};
+
+#endif // VERIFY_H
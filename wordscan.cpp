@@ -0,0 +1,173 @@
+#include "wordscan.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORDSCAN_X86 1
+#endif
+
+namespace {
+
+inline uint64_t loadWord(const uint8_t* p) {
+    uint64_t val;
+    std::memcpy(&val, p, sizeof(val));
+    return val;
+}
+
+// 逐字检查 [begin, words)，结果追加在 out[count] 之后，返回新的个数（也用于向量实现的尾部）
+size_t scanWords(const uint8_t* data, size_t begin, size_t words, uint32_t* out, size_t count) {
+    for (size_t i = begin; i < words; i++) {
+        if (loadWord(data + i * 8) != 0) {
+            out[count++] = static_cast<uint32_t>(i);
+        }
+    }
+    return count;
+}
+
+size_t findNonZeroScalar(const uint8_t* data, size_t words, uint32_t* out) {
+    return scanWords(data, 0, words, out, 0);
+}
+
+bool allZeroScalar(const uint8_t* data, size_t len) {
+    size_t i = 0;
+    uint64_t acc = 0;
+    for (; i + 8 <= len; i += 8) {
+        acc |= loadWord(data + i);
+    }
+    for (; i < len; i++) {
+        acc |= data[i];
+    }
+    return acc == 0;
+}
+
+#ifdef __SSE2__
+
+// SSE2 没有 64 位比较：按 32 位比较，一个字的两半都为零时该字为零
+size_t findNonZeroSSE2(const uint8_t* data, size_t words, uint32_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= words; i += 8) {
+        const uint8_t* p = data + i * 8;
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+        __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+        __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48));
+        __m128i any = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, zero)) == 0xFFFF) continue;
+
+        // 每个 32 位半字为零时对应位为 1，共 16 位（8 个字）
+        unsigned zero_halves =
+            static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v0, zero)))) |
+            static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v1, zero)))) << 4 |
+            static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v2, zero)))) << 8 |
+            static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v3, zero)))) << 12;
+        for (unsigned w = 0; w < 8; w++) {
+            if (((zero_halves >> (w * 2)) & 3) != 3) {
+                out[count++] = static_cast<uint32_t>(i + w);
+            }
+        }
+    }
+    return scanWords(data, i, words, out, count);
+}
+
+bool allZeroSSE2(const uint8_t* data, size_t len) {
+    size_t i = 0;
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 64 <= len; i += 64) {
+        const uint8_t* p = data + i;
+        acc = _mm_or_si128(acc, _mm_or_si128(
+            _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16))),
+            _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48)))));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) != 0xFFFF) return false;
+    return allZeroScalar(data + i, len - i);
+}
+
+#endif  // __SSE2__
+
+#ifdef WORDSCAN_X86
+
+__attribute__((target("avx2")))
+size_t findNonZeroAVX2(const uint8_t* data, size_t words, uint32_t* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= words; i += 8) {
+        const uint8_t* p = data + i * 8;
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        __m256i any = _mm256_or_si256(v0, v1);
+        if (_mm256_testz_si256(any, any)) continue;
+
+        // 每个字为零时对应位为 1
+        unsigned zero_words =
+            static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v0, zero)))) |
+            static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v1, zero)))) << 4;
+        unsigned nonzero = ~zero_words & 0xFF;
+        while (nonzero) {
+            out[count++] = static_cast<uint32_t>(i + __builtin_ctz(nonzero));
+            nonzero &= nonzero - 1;
+        }
+    }
+    return scanWords(data, i, words, out, count);
+}
+
+__attribute__((target("avx2")))
+bool allZeroAVX2(const uint8_t* data, size_t len) {
+    size_t i = 0;
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 64 <= len; i += 64) {
+        const uint8_t* p = data + i;
+        acc = _mm256_or_si256(acc, _mm256_or_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32))));
+    }
+    if (!_mm256_testz_si256(acc, acc)) return false;
+    return allZeroScalar(data + i, len - i);
+}
+
+#endif  // WORDSCAN_X86
+
+struct Kernels {
+    size_t (*find_non_zero)(const uint8_t*, size_t, uint32_t*);
+    bool (*all_zero)(const uint8_t*, size_t);
+    const char* name;
+};
+
+Kernels selectKernels() {
+#ifdef WORDSCAN_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return {findNonZeroAVX2, allZeroAVX2, "avx2"};
+    }
+#endif
+#ifdef __SSE2__
+    return {findNonZeroSSE2, allZeroSSE2, "sse2"};
+#endif
+    return {findNonZeroScalar, allZeroScalar, "scalar"};
+}
+
+const Kernels& kernels() {
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+}  // namespace
+
+namespace WordScan {
+
+size_t findNonZero(const uint8_t* data, size_t words, uint32_t* out) {
+    return kernels().find_non_zero(data, words, out);
+}
+
+bool allZero(const uint8_t* data, size_t len) {
+    return kernels().all_zero(data, len);
+}
+
+const char* implementation() {
+    return kernels().name;
+}
+
+}  // namespace WordScan
@@ -0,0 +1,19 @@
+#ifndef WORDSCAN_H
+#define WORDSCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 批量查找非零的 8 字节字（x86 上按 CPU 支持选择 AVX2 / SSE2 实现，其他平台用标量实现）
+// 整块为零的 64 字节直接跳过，适合大段以零为主的数据（程序加载时的 .quad 0 数组等）
+namespace WordScan {
+    // 在 data 开始的 words 个字（不要求对齐）中查找非零字，把下标按升序写入 out
+    // （out 至少能容纳 words 项），返回找到的个数
+    size_t findNonZero(const uint8_t* data, size_t words, uint32_t* out);
+    // [data, data+len) 是否全为零
+    bool allZero(const uint8_t* data, size_t len);
+    // 当前使用的实现："avx2"、"sse2" 或 "scalar"
+    const char* implementation();
+}
+
+#endif // WORDSCAN_H
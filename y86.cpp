@@ -1,6 +1,33 @@
 #include "y86.h"
+#include "wordscan.h"
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
+namespace {
+
+// Y86 内存按小端序存放；用 memcpy 做单次非对齐的 8 字节访问，大端主机上再交换字节
+inline uint64_t hostToLE(uint64_t val) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap64(val);
+#else
+    return val;
+#endif
+}
+
+inline uint64_t loadLE64(const uint8_t* p) {
+    uint64_t val;
+    std::memcpy(&val, p, sizeof(val));
+    return hostToLE(val);
+}
+
+inline void storeLE64(uint8_t* p, uint64_t val) {
+    val = hostToLE(val);
+    std::memcpy(p, &val, sizeof(val));
+}
+
+}  // namespace
+
 namespace Y86 {
     const std::map<uint8_t, std::string> REG_NAMES = {
         {RAX, "rax"}, {RCX, "rcx"}, {RDX, "rdx"}, {RBX, "rbx"},
@@ -15,6 +42,120 @@ namespace Y86 {
         if (it != REG_NAMES.end()) return it->second;
         return "";
     }
+
+    const char* getIcodeName(uint8_t icode) {
+        static const char* const NAMES[] = {
+            "halt", "nop", "rrmovq", "irmovq", "rmmovq", "mrmovq",
+            "opq", "jxx", "call", "ret", "pushq", "popq"
+        };
+        return icode < sizeof(NAMES) / sizeof(NAMES[0]) ? NAMES[icode] : "inv";
+    }
+
+    bool evalCondition(uint8_t ifun, const ConditionCodes& cc) {
+        switch (ifun) {
+            case C_YES: return true;
+            case C_LE: return ((cc.SF || cc.ZF) && !cc.OF) || ((!cc.SF && !cc.ZF) && cc.OF);
+            case C_L: return cc.SF != cc.OF;
+            case C_E: return cc.ZF;
+            case C_NE: return !cc.ZF;
+            case C_GE: return cc.SF == cc.OF;
+            case C_G: return !cc.ZF && (cc.SF == cc.OF);
+            default: return false;
+        }
+    }
+
+    int64_t aluOp(uint8_t ifun, int64_t valA, int64_t valB, ConditionCodes& cc) {
+        int64_t valE = 0;
+        bool overflow = false;
+        // 用无符号运算避免有符号溢出的未定义行为
+        switch (ifun) {
+            case ADD:
+                valE = static_cast<int64_t>(static_cast<uint64_t>(valA) + static_cast<uint64_t>(valB));
+                overflow = ((valA > 0 && valB > 0 && valE < 0) ||
+                           (valA < 0 && valB < 0 && valE > 0));
+                break;
+            case SUB:
+                valE = static_cast<int64_t>(static_cast<uint64_t>(valB) - static_cast<uint64_t>(valA));
+                overflow = ((valA < 0 && valB > 0 && valE < 0) ||
+                           (valA > 0 && valB < 0 && valE > 0));
+                break;
+            case AND:
+                valE = valA & valB;
+                break;
+            case XOR:
+                valE = valA ^ valB;
+                break;
+        }
+        cc.ZF = (valE == 0);
+        cc.SF = (valE < 0);
+        cc.OF = overflow;
+        return valE;
+    }
+
+    bool needRegids(uint8_t icode) {
+        return icode == RRMOVQ || icode == IRMOVQ || 
+               icode == RMMOVQ || icode == MRMOVQ ||
+               icode == OPQ || icode == PUSHQ || 
+               icode == POPQ || icode == CMOVXX;
+    }
+
+    bool needValC(uint8_t icode) {
+        return icode == IRMOVQ || icode == RMMOVQ || 
+               icode == MRMOVQ || icode == JXX || 
+               icode == CALL;
+    }
+
+    Instruction decodeInstruction(const Memory& mem, uint64_t pc) {
+        Instruction inst;
+        inst.stat = STAT_AOK;
+        
+        if (!mem.inBounds(pc, 1)) {
+            inst.stat = STAT_ADR;
+            return inst;
+        }
+        
+        uint8_t byte1 = mem.readByte(pc);
+        inst.icode = (byte1 >> 4) & 0xF;
+        inst.ifun = byte1 & 0xF;
+        inst.length = 1;
+        
+        // 检查非法指令（包括0xFF等）
+        if (inst.icode > 0xB || inst.icode == 0xF) {
+            inst.stat = STAT_INS;
+            return inst;
+        }
+        inst.need_regids = needRegids(inst.icode);
+        inst.need_valC = needValC(inst.icode);
+        
+        // 需要寄存器ID的指令
+        if (inst.need_regids) {
+            if (!mem.inBounds(pc, 2)) {
+                inst.stat = STAT_ADR;
+                return inst;
+            }
+            uint8_t byte2 = mem.readByte(pc + 1);
+            inst.rA = (byte2 >> 4) & 0xF;
+            inst.rB = byte2 & 0xF;
+            inst.length = 2;
+        } else {
+            inst.rA = RNONE;
+            inst.rB = RNONE;
+        }
+        
+        // 需要立即数的指令
+        if (inst.need_valC) {
+            if (!mem.inBounds(pc, inst.length + 8)) {
+                inst.stat = STAT_ADR;
+                return inst;
+            }
+            inst.valC = mem.read64(pc + inst.length);
+            inst.length += 8;
+        } else {
+            inst.valC = 0;
+        }
+        
+        return inst;
+    }
 }
 
 // RegisterFile 实现
@@ -41,52 +182,192 @@ void RegisterFile::reset() {
 }
 
 // Memory 实现
-Memory::Memory() {
+Memory::Memory(const MemoryConfig& config) {
+    configure(config);
+}
+
+void Memory::configure(const MemoryConfig& config) {
+    // 地址空间按页取整（至少一页）
+    uint64_t size = config.size;
+    if (size == 0) size = PAGE_SIZE;
+    if (size != FULL_ADDRESS_SPACE && (size & (PAGE_SIZE - 1)) != 0) {
+        uint64_t rounded = (size | (PAGE_SIZE - 1)) + 1;
+        size = (rounded == 0) ? FULL_ADDRESS_SPACE : rounded;
+    }
+    last_addr_ = (size == FULL_ADDRESS_SPACE) ? FULL_ADDRESS_SPACE : size - 1;
+    word_end_ = (last_addr_ >= 7) ? last_addr_ - 6 : 0;
+    max_pages_ = config.max_pages;
     reset();
 }
 
+const uint8_t* Memory::findPage(uint64_t page_num) const {
+    if (last_page_ != nullptr && last_page_num_ == page_num) {
+        return last_page_;
+    }
+    auto it = pages_.find(page_num);
+    if (it == pages_.end()) {
+        return nullptr;
+    }
+    last_page_num_ = page_num;
+    last_page_ = it->second->bytes;
+    return last_page_;
+}
+
+uint8_t* Memory::touchPage(uint64_t page_num) {
+    if (last_page_ != nullptr && last_page_num_ == page_num) {
+        return last_page_;
+    }
+    auto& page = pages_[page_num];
+    if (!page) {
+        if (max_pages_ != 0 && pages_.size() > max_pages_) {
+            pages_.erase(page_num);
+            throw std::runtime_error("Memory page limit exceeded");
+        }
+        page.reset(new Page());  // 值初始化，页内容全为0
+    }
+    last_page_num_ = page_num;
+    last_page_ = page->bytes;
+    return last_page_;
+}
+
+uint8_t Memory::readByte(uint64_t addr) const {
+    if (!inBounds(addr, 1)) {
+        throw std::runtime_error("Memory read out of bounds");
+    }
+    const uint8_t* page = findPage(addr >> PAGE_BITS);
+    return page ? page[addr & (PAGE_SIZE - 1)] : 0;
+}
+
 uint64_t Memory::read64(uint64_t addr) const {
-    // 边界检查：addr 必须 < MEM_SIZE - 7 才能读取 8 字节
-    // 使用此检查避免 addr + 8 溢出的问题
-    if (addr >= MEM_SIZE || addr > MEM_SIZE - 8) {
+    if (!wordInBounds(addr)) {
         throw std::runtime_error("Memory read out of bounds");
     }
+    uint64_t offset = addr & (PAGE_SIZE - 1);
+    if (offset <= PAGE_SIZE - 8) {
+        // 快速路径：8字节都在同一页内
+        const uint8_t* page = findPage(addr >> PAGE_BITS);
+        return page ? loadLE64(page + offset) : 0;
+    }
+    // 跨页访问：逐字节读取
     uint64_t val = 0;
-    // 小端序读取
     for (int i = 0; i < 8; i++) {
-        val |= ((uint64_t)mem[addr + i]) << (i * 8);
+        val |= ((uint64_t)readByte(addr + i)) << (i * 8);
     }
     return val;
 }
 
 void Memory::write64(uint64_t addr, uint64_t val) {
-    // 边界检查：addr 必须 < MEM_SIZE - 7 才能写入 8 字节
-    // 使用此检查避免 addr + 8 溢出的问题
-    if (addr >= MEM_SIZE || addr > MEM_SIZE - 8) {
+    if (!wordInBounds(addr)) {
         throw std::runtime_error("Memory write out of bounds");
     }
-    // 小端序写入
-    for (int i = 0; i < 8; i++) {
-        mem[addr + i] = (val >> (i * 8)) & 0xFF;
+    uint64_t offset = addr & (PAGE_SIZE - 1);
+    if (offset <= PAGE_SIZE - 8) {
+        // 快速路径：8字节都在同一页内
+        storeLE64(touchPage(addr >> PAGE_BITS) + offset, val);
+    } else {
+        // 跨页：先分配两页再写入，超出页数上限时存储器保持不变
+        uint8_t* low = touchPage(addr >> PAGE_BITS);
+        uint8_t* high = touchPage((addr >> PAGE_BITS) + 1);
+        for (int i = 0; i < 8; i++) {
+            uint64_t a = offset + i;
+            uint8_t* page = (a < PAGE_SIZE) ? low : high;
+            page[a & (PAGE_SIZE - 1)] = (val >> (i * 8)) & 0xFF;
+        }
+    }
+    // 对齐写入直接使用写入的值；非对齐写入最多跨越两个对齐字，重新读取
+    uint64_t first_word = addr & ~7ULL;
+    if (first_word == addr) {
+        updateWord(addr, val, dirty_.size());
+        return;
+    }
+    uint64_t last_word = first_word + 8;
+    updateWord(first_word, read64(first_word), dirty_.size());
+    if (wordInBounds(last_word)) {
+        updateWord(last_word, read64(last_word), dirty_.size());
     }
 }
 
-void Memory::reset() {
-    for (size_t i = 0; i < MEM_SIZE; i++) {
-        mem[i] = 0;
+void Memory::markCode(uint64_t addr, uint64_t len) {
+    if (len == 0) return;
+    uint64_t first_word = addr & ~7ULL;
+    uint64_t words = (((addr + len - 1) & ~7ULL) - first_word) / 8 + 1;
+    for (uint64_t i = 0; i < words; i++) {
+        code_words_.insert(first_word + i * 8);
     }
 }
 
-std::map<uint64_t, int64_t> Memory::getNonZeroMemory() const {
-    std::map<uint64_t, int64_t> result;
-    for (uint64_t addr = 0; addr < MEM_SIZE; addr += 8) {
-        uint64_t val = read64(addr);
-        if (val != 0) {
-            // 将无符号值解释为有符号
-            int64_t signed_val = static_cast<int64_t>(val);
-            result[addr] = signed_val;
+void Memory::writeBytes(uint64_t addr, const uint8_t* data, size_t len) {
+    if (len == 0) return;
+    if (!inBounds(addr, len)) {
+        throw std::runtime_error("Memory write out of bounds");
+    }
+    // 按页拷贝；目标页尚未分配且写入的全是零时不分配（未分配的页读出来就是0）
+    size_t done = 0;
+    while (done < len) {
+        uint64_t a = addr + done;
+        uint64_t offset = a & (PAGE_SIZE - 1);
+        size_t chunk = std::min<uint64_t>(len - done, PAGE_SIZE - offset);
+        if (findPage(a >> PAGE_BITS) != nullptr || !WordScan::allZero(data + done, chunk)) {
+            std::memcpy(touchPage(a >> PAGE_BITS) + offset, data + done, chunk);
+        }
+        done += chunk;
+    }
+
+    // 更新非零字集合和脏字。TraceLog 只关心值的变化，所以写入前后都是零的字不必标记；
+    // 本次更新的字互不相同，只需与写入前已有的脏字查重（加载大程序时避免平方复杂度）
+    uint64_t first_word = addr & ~7ULL;
+    uint64_t last_word = (addr + len - 1) & ~7ULL;
+    size_t dirty_before = dirty_.size();
+    // 1. 原来非零、现在变为零的字
+    std::vector<uint64_t> cleared;
+    for (auto it = nonzero_.lower_bound(first_word); it != nonzero_.end() && it->first <= last_word; ++it) {
+        if (read64(it->first) == 0) cleared.push_back(it->first);
+    }
+    for (uint64_t word : cleared) {
+        updateWord(word, 0, dirty_before);
+    }
+    // 2. 现在非零的字：逐页批量扫描，跳过全零的块（字按8字节对齐，不会跨页）
+    uint32_t found[PAGE_SIZE / 8];
+    for (uint64_t page_num = first_word >> PAGE_BITS; page_num <= last_word >> PAGE_BITS; page_num++) {
+        const uint8_t* page = findPage(page_num);
+        if (page != nullptr) {
+            uint64_t page_base = page_num << PAGE_BITS;
+            uint64_t begin = std::max(first_word, page_base);
+            uint64_t end = std::min(last_word, page_base + PAGE_SIZE - 8);
+            const uint8_t* words = page + (begin - page_base);
+            size_t count = WordScan::findNonZero(words, (end - begin) / 8 + 1, found);
+            for (size_t i = 0; i < count; i++) {
+                updateWord(begin + found[i] * 8ULL, loadLE64(words + found[i] * 8ULL), dirty_before);
+            }
         }
     }
-    return result;
+}
+
+void Memory::reset() {
+    // 释放所有页，之后的读取都返回0
+    pages_.clear();
+    last_page_ = nullptr;
+    last_page_num_ = 0;
+    nonzero_.clear();
+    dirty_.clear();
+    code_words_.clear();
+    code_writes_.clear();
+}
+void Memory::updateWord(uint64_t word_addr, uint64_t val, size_t dirty_checked) {
+    if (val != 0) {
+        // 将无符号值解释为有符号
+        nonzero_[word_addr] = static_cast<int64_t>(val);
+    } else {
+        nonzero_.erase(word_addr);
+    }
+    // 每次退休之间写入很少，线性查重即可
+    auto checked_end = dirty_.begin() + dirty_checked;
+    if (std::find(dirty_.begin(), checked_end, word_addr) == checked_end) {
+        dirty_.push_back(word_addr);
+    }
+    // 写入了已译码的代码（自修改代码）：记录下来，由预译码缓存失效对应条目
+    if (!code_words_.empty() && code_words_.count(word_addr)) {
+        code_writes_.push_back(word_addr);
+    }
 }
 
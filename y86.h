@@ -4,6 +4,9 @@
 #include <cstdint>
 #include <string>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 // Y86-64 指令码定义
@@ -62,11 +65,21 @@ namespace Y86 {
     constexpr uint8_t STAT_ADR = 3;  // 地址错误
     constexpr uint8_t STAT_INS = 4;  // 非法指令
 
+    // 防止无限循环：各引擎都在退休这么多条指令后以 STAT_INS 停止（不再记录状态），
+    // 所以不终止的程序在所有引擎上也输出相同的状态序列
+    constexpr uint64_t MAX_RETIRED = 1000000;
+
     // 寄存器名称映射
     extern const std::map<uint8_t, std::string> REG_NAMES;
     
     // 获取寄存器名称
     std::string getRegName(uint8_t reg);
+    // 获取指令助记符（按icode，不区分ifun；非法icode返回"inv"）
+    const char* getIcodeName(uint8_t icode);
+
+    // 指令是否带寄存器字节 / 8字节立即数
+    bool needRegids(uint8_t icode);
+    bool needValC(uint8_t icode);
 }
 
 // 条件码结构
@@ -76,6 +89,13 @@ struct ConditionCodes {
     bool OF = false;  // Overflow Flag
 };
 
+namespace Y86 {
+    // 根据条件码判断 JXX/CMOVXX 的条件是否成立
+    bool evalCondition(uint8_t ifun, const ConditionCodes& cc);
+    // OPQ运算：返回 valB op valA，并把新的条件码写入 cc
+    int64_t aluOp(uint8_t ifun, int64_t valA, int64_t valB, ConditionCodes& cc);
+}
+
 // 寄存器文件（15个通用寄存器 + RNONE）
 class RegisterFile {
 public:
@@ -87,19 +107,101 @@ public:
     void reset();
 };
 
+// 内存配置
+struct MemoryConfig {
+    uint64_t size = 1024 * 1024;  // 地址空间大小（字节），FULL_ADDRESS_SPACE 表示完整的64位地址空间
+    uint64_t max_pages = 0;       // 最多驻留的页数，0 表示不限制
+};
+
 // 内存（模拟大端序，但实际按小端序处理）
+// 稀疏分页实现：4KB页在第一次写入时才分配，读取未分配的页返回0，
+// 启动开销和驻留内存只与程序实际使用的地址范围有关。
+// 所有写入都必须经过 write64 / writeBytes，这样才能维护非零字集合和脏字列表
 class Memory {
 public:
-    static constexpr size_t MEM_SIZE = 1024 * 1024;  // 1MB
-    uint8_t mem[MEM_SIZE];
+    static constexpr uint64_t DEFAULT_SIZE = 1024 * 1024;  // 1MB
+    static constexpr uint64_t FULL_ADDRESS_SPACE = ~0ULL;
+    static constexpr uint64_t PAGE_BITS = 12;
+    static constexpr uint64_t PAGE_SIZE = 1ULL << PAGE_BITS;  // 4KB
+    
+    explicit Memory(const MemoryConfig& config = MemoryConfig());
+    // 重新配置地址空间（会清空内存）
+    void configure(const MemoryConfig& config);
     
-    Memory();
+    // [addr, addr+len) 是否全部落在地址空间内
+    bool inBounds(uint64_t addr, uint64_t len) const {
+        return len == 0 || (addr <= last_addr_ && len - 1 <= last_addr_ - addr);
+    }
+    // [addr, addr+8) 是否在地址空间内（read64/write64 的边界检查，只比较一次）
+    bool wordInBounds(uint64_t addr) const { return addr < word_end_; }
+    // 地址空间中最后一个合法字节的地址
+    uint64_t lastAddress() const { return last_addr_; }
+    // 当前驻留的页数
+    size_t residentPages() const { return pages_.size(); }
+    
+    uint8_t readByte(uint64_t addr) const;
     uint64_t read64(uint64_t addr) const;
     void write64(uint64_t addr, uint64_t val);
+    // 批量写入（用于加载程序）
+    void writeBytes(uint64_t addr, const uint8_t* data, size_t len);
     void reset();
-    // 获取所有非零内存值（用于输出）
-    std::map<uint64_t, int64_t> getNonZeroMemory() const;
+    // 获取所有非零内存值（用于输出），按8字节对齐的地址排序，随写入实时维护
+    const std::map<uint64_t, int64_t>& getNonZeroMemory() const { return nonzero_; }
+    // 自上次 clearDirty() 以来被写过的对齐字地址（不重复）
+    const std::vector<uint64_t>& getDirtyWords() const { return dirty_; }
+    void clearDirty() { dirty_.clear(); }
+
+    // 代码区跟踪（用于预译码缓存失效）
+    // 标记 [addr, addr+len) 为已译码的代码；之后写入这些字会被记录下来
+    void markCode(uint64_t addr, uint64_t len);
+    // 自上次 clearCodeWrites() 以来被写过的代码字地址
+    const std::vector<uint64_t>& getCodeWrites() const { return code_writes_; }
+    void clearCodeWrites() { code_writes_.clear(); }
+
+private:
+    struct Page {
+        uint8_t bytes[PAGE_SIZE];
+    };
+    
+    // 查找页（不分配），未分配时返回 nullptr
+    const uint8_t* findPage(uint64_t page_num) const;
+    // 查找页，未分配时分配一个全零页
+    uint8_t* touchPage(uint64_t page_num);
+    // 对齐字写入后的新值为 val：更新非零字集合并标记为脏
+    // dirty_checked：只在 dirty_ 的前这么多项中查重（批量写入的字互不相同）
+    void updateWord(uint64_t word_addr, uint64_t val, size_t dirty_checked);
+
+    uint64_t last_addr_;
+    uint64_t word_end_;  // 8字节访问合法起始地址的上界（不含），地址空间不足8字节时为0
+    uint64_t max_pages_;
+    std::unordered_map<uint64_t, std::unique_ptr<Page>> pages_;
+    // 最近访问的页（连续访问同一页时跳过哈希查找）
+    mutable uint64_t last_page_num_;
+    mutable uint8_t* last_page_;
+
+    std::map<uint64_t, int64_t> nonzero_;  // 非零字：地址 -> 值
+    std::vector<uint64_t> dirty_;          // 脏字地址
+    std::unordered_set<uint64_t> code_words_;  // 含已译码指令字节的字地址
+    std::vector<uint64_t> code_writes_;        // 被写过的代码字地址
 };
 
+// 指令解析结果
+struct Instruction {
+    uint8_t icode = Y86::NOP;
+    uint8_t ifun = 0;
+    uint8_t rA = Y86::RNONE;
+    uint8_t rB = Y86::RNONE;
+    uint64_t valC = 0;
+    uint64_t length = 0;  // 指令长度（字节）
+    bool need_regids = false;
+    bool need_valC = false;
+    uint8_t stat = Y86::STAT_AOK;
+};
+
+namespace Y86 {
+    // 从内存中解析 pc 处的指令（不经过缓存）
+    Instruction decodeInstruction(const Memory& mem, uint64_t pc);
+}
+
 #endif // Y86_H
 
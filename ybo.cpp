@@ -0,0 +1,99 @@
+#include "ybo.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+void putLE(std::vector<uint8_t>& out, uint64_t val, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(val >> (i * 8)));
+    }
+}
+
+uint64_t getLE(const uint8_t* p, int bytes) {
+    uint64_t val = 0;
+    for (int i = 0; i < bytes; i++) {
+        val |= static_cast<uint64_t>(p[i]) << (i * 8);
+    }
+    return val;
+}
+
+}  // namespace
+
+namespace Ybo {
+
+bool isYbo(const uint8_t* data, size_t len) {
+    return len >= sizeof(MAGIC) && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+uint64_t checksum(const uint8_t* data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::vector<uint8_t> encode(const ProgramImage& image) {
+    std::vector<uint8_t> out;
+    out.reserve(HEADER_SIZE + image.segments.size() * SEGMENT_HEADER_SIZE +
+                image.bytes.size() + CHECKSUM_SIZE);
+    for (char c : MAGIC) {
+        out.push_back(static_cast<uint8_t>(c));
+    }
+    putLE(out, VERSION, 4);
+    putLE(out, image.segments.size(), 4);
+    putLE(out, 0, 4);
+    for (const auto& seg : image.segments) {
+        putLE(out, seg.addr, 8);
+        putLE(out, seg.length, 8);
+        const uint8_t* bytes = image.bytes.data() + seg.offset;
+        out.insert(out.end(), bytes, bytes + seg.length);
+    }
+    putLE(out, checksum(out.data(), out.size()), 8);
+    return out;
+}
+
+ProgramImage decode(std::vector<uint8_t>&& file) {
+    if (!isYbo(file.data(), file.size())) {
+        throw std::runtime_error("Not a .ybo file");
+    }
+    if (file.size() < HEADER_SIZE + CHECKSUM_SIZE) {
+        throw std::runtime_error("Truncated .ybo file");
+    }
+    size_t body = file.size() - CHECKSUM_SIZE;
+    if (checksum(file.data(), body) != getLE(file.data() + body, 8)) {
+        throw std::runtime_error(".ybo checksum mismatch");
+    }
+    if (getLE(file.data() + 4, 4) != VERSION) {
+        throw std::runtime_error("Unsupported .ybo version");
+    }
+
+    ProgramImage image;
+    uint64_t count = getLE(file.data() + 8, 4);
+    size_t pos = HEADER_SIZE;
+    for (uint64_t i = 0; i < count; i++) {
+        if (body - pos < SEGMENT_HEADER_SIZE) {
+            throw std::runtime_error("Truncated .ybo segment header");
+        }
+        uint64_t addr = getLE(file.data() + pos, 8);
+        uint64_t len = getLE(file.data() + pos + 8, 8);
+        pos += SEGMENT_HEADER_SIZE;
+        if (len > body - pos) {
+            throw std::runtime_error("Truncated .ybo segment data");
+        }
+        if (len > 0) {
+            image.segments.push_back({addr, pos, static_cast<size_t>(len)});
+        }
+        pos += static_cast<size_t>(len);
+    }
+    if (pos != body) {
+        throw std::runtime_error("Trailing data in .ybo file");
+    }
+    // 段直接引用文件缓冲区中的数据
+    image.bytes = std::move(file);
+    return image;
+}
+
+}  // namespace Ybo
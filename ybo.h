@@ -0,0 +1,38 @@
+#ifndef YBO_H
+#define YBO_H
+
+#include "loader.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// .ybo 二进制目标文件格式（所有整数均为小端序）
+//
+//   偏移  大小  内容
+//   0     4     魔数 "Y86B"
+//   4     4     版本号（当前为 1）
+//   8     4     段数 N
+//   12    4     保留（0）
+//   16    ...   N 个段：8字节地址、8字节长度、长度个字节
+//   末尾  8     之前所有字节的 FNV-1a 64 校验和
+namespace Ybo {
+    constexpr char MAGIC[4] = {'Y', '8', '6', 'B'};
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 16;
+    constexpr size_t SEGMENT_HEADER_SIZE = 16;
+    constexpr size_t CHECKSUM_SIZE = 8;
+
+    // 数据是否以 .ybo 魔数开头
+    bool isYbo(const uint8_t* data, size_t len);
+
+    // 把程序映像编码为 .ybo
+    std::vector<uint8_t> encode(const ProgramImage& image);
+
+    // 解析 .ybo：直接接管文件缓冲区作为映像的字节存储，段只记录偏移，不复制数据。
+    // 魔数/版本/长度/校验和不正确时抛出 std::runtime_error
+    ProgramImage decode(std::vector<uint8_t>&& file);
+
+    uint64_t checksum(const uint8_t* data, size_t len);
+}
+
+#endif // YBO_H